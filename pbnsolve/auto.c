@@ -0,0 +1,159 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Automatic Algorithm Selection
+ *
+ * With -aA we start out just line solving.  If that stalls, we measure a few
+ * cheap things about the puzzle and the grid as the line solver left it,
+ * and use them to pick one of the algorithm settings that could be given
+ * after -a, by looking them up in the AUTO_RULES table in config.h.  The
+ * first rule whose ranges all contain the puzzle's values is used.
+ *
+ * The features are:
+ *
+ *   cells	Number of cells in the puzzle.
+ *   colors	Number of colors, including the background.
+ *   solved	Fraction of the cells solved by line solving.
+ *   density	Fraction of the cells covered by clue blocks.
+ *   slack	Average over all lines of the number of cells the blocks can
+ *		slide, as a fraction of the line length.
+ *   spread	Standard deviation of that, over all lines.
+ *
+ * With -t, the features are measured and printed even without -aA.  So the
+ * table can be retuned by running a set of puzzles with -p and -t, which
+ * gives the features along with the settings that won for each puzzle.
+ */
+
+#include "pbnsolve.h"
+#include <math.h>
+
+int mayauto= 0;			/* Pick algorithms at the first stall? */
+int measurefeatures= 0;		/* Measure the features even if not? */
+
+typedef struct {
+    long mincells, maxcells;
+    int maxcolors;
+    float minsolved, maxsolved;
+    float mindensity, maxdensity;
+    float minslack, maxslack;
+    float minspread, maxspread;
+    char *alg;
+} AutoRule;
+
+static AutoRule autorule[]= AUTO_RULES;
+
+#define NAUTORULE (sizeof(autorule)/sizeof(AutoRule))
+
+static char *autoalg= NULL;	/* The settings we picked */
+static int measured= 0;		/* Have the features been measured? */
+static long fcells;		/* The features */
+static int fcolors;
+static float fsolved, fdensity, fslack, fspread;
+
+
+/* AUTO_FEATURES - Measure the puzzle and the current grid, if we haven't
+ * already.  Called when line solving first stalls.
+ */
+
+void auto_features(Puzzle *puz, Solution *sol)
+{
+    dir_t k;
+    line_t i, min;
+    int b, nline= 0;
+    long covered= 0;
+    Clue *clue;
+    double s, sum= 0.0, sumsq= 0.0;
+
+    if (measured) return;
+    measured= 1;
+
+    fcells= puz->ncells;
+    fcolors= puz->ncolor;
+    fsolved= (float)puz->nsolved / puz->ncells;
+
+    for (k= 0; k < puz->nset; k++)
+	for (i= 0; i < puz->n[k]; i++)
+	{
+	    clue= &puz->clue[k][i];
+	    min= 0;
+	    for (b= 0; b < clue->n; b++)
+	    {
+		covered+= clue->length[b];
+		min+= clue->length[b];
+		if (b > 0 && clue->color[b] == clue->color[b-1]) min++;
+	    }
+	    s= (double)(clue->linelen - min) / clue->linelen;
+	    sum+= s;
+	    sumsq+= s * s;
+	    nline++;
+	}
+
+    fdensity= (float)covered / (puz->nset * puz->ncells);
+    fslack= sum / nline;
+    s= sumsq / nline - fslack * fslack;
+    fspread= (s > 0.0) ? sqrt(s) : 0.0;
+}
+
+
+/* AUTO_SELECT - Line solving has stalled for the first time.  Pick the
+ * algorithms to use from here on, and set up whatever they need that would
+ * normally have been set up at startup.
+ */
+
+void auto_select(Puzzle *puz, Solution *sol)
+{
+    AutoRule *r;
+    char *a;
+
+    auto_features(puz, sol);
+
+    for (r= autorule; r < autorule + NAUTORULE - 1; r++)
+	if (fcells >= r->mincells && fcells <= r->maxcells &&
+	    fcolors <= r->maxcolors &&
+	    fsolved >= r->minsolved && fsolved <= r->maxsolved &&
+	    fdensity >= r->mindensity && fdensity <= r->maxdensity &&
+	    fslack >= r->minslack && fslack <= r->maxslack &&
+	    fspread >= r->minspread && fspread <= r->maxspread)
+	    break;
+    autoalg= r->alg;
+
+    if (VA) printf("A: AUTOMATIC CHOICE -a%s\n", autoalg);
+
+    setalg(0);
+    for (a= autoalg; *a != '\0'; a++)
+	setalg(*a);
+    if (!maybacktrack) checksolution= checkunique= 0;
+
+    if (mergeprobe) init_merge(puz);
+    if (mayprobe && mayimply) init_imply(puz);
+    if (maybacktrack && maytrans) init_trans(puz, sol);
+    if (mayprobe)
+	probe_init(puz, sol);
+    else
+	bookkeeping_on(puz, sol);
+}
+
+
+/* AUTO_STATS - Print the features and what we picked */
+
+void auto_stats(FILE *fp)
+{
+    if (!measured) return;
+    fprintf(fp,"Puzzle Features: cells %ld, colors %d, solved %.3f, "
+	    "density %.3f, slack %.3f, spread %.3f\n", fcells, fcolors,
+	    fsolved, fdensity, fslack, fspread);
+    if (autoalg != NULL)
+	fprintf(fp,"Automatic Choice: -a%s\n", autoalg);
+}
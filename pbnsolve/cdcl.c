@@ -0,0 +1,1026 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Clause Learning Search
+ *
+ * Probing and guessing search a tree, and when a branch dies all they keep
+ * of it is that one guess.  On some puzzles the same few cells doom branch
+ * after branch all over the tree.  This is a search in the style of modern
+ * SAT solvers (conflict driven clause learning) that notices that.
+ *
+ * Each cell is a boolean variable, true for black.  Each line is a
+ * propagator:  given the cells assigned so far, a dynamic program over the
+ * block positions finds which of the line's other cells can only be one
+ * color, or that the line can't be filled at all.  When a line forces a
+ * cell, or fails, we can later be asked why, and answer with the cells of
+ * the line that were set before that, trimmed down greedily to ones that
+ * are still enough to force it.  From those, each contradiction is traced
+ * back to a clause saying which combination of cell values to avoid, which
+ * is kept and used like the lines from then on.  Cells are picked for
+ * guessing by how often they have turned up in recent contradictions, and
+ * the search is restarted every so often, keeping the clauses.
+ *
+ * It is used from the first time line solving stalls with -aK, or once the
+ * ordinary search has line solved CDCL_BUDGET lines.  It only
+ * handles black and white grid puzzles without blotted clues, and isn't
+ * used by a search that has been split up between processes, or for
+ * finding more solutions after the first.  In those cases the ordinary
+ * search just carries on.
+ */
+
+#include "pbnsolve.h"
+
+int mayclause= 0;		/* Use clause learning search? */
+
+static long conflicts= 0, decisions= 0, learned= 0, crestarts= 0;
+static int ran= 0;		/* Has the search been used? */
+static int usable= -1;		/* Can this puzzle be handled? -1 if unknown */
+
+/* A literal is 2*v+1 for cell v black, 2*v for it white */
+#define LIT(v,b) (2*(v)+(b))
+#define NOCONF (-1)		/* No conflict */
+#define LINEREASON(l) (-2-(l))	/* Reason or conflict that is a line */
+
+typedef struct {
+    Cell **cell;
+    Clue *clue;
+    line_t len;
+} CLine;
+
+static int nvar, nline;
+static CLine *cline;
+static int *lineof;		/* The row and column of cell v at [2*v+k] */
+
+/* Assignment state of each variable */
+static signed char *val;	/* 1 black, 0 white, -1 unassigned */
+static int *level;		/* Decision level it was set at */
+static int *reason;		/* Clause or line that set it, or -1 */
+static int *tpos;		/* Position in the trail */
+static char *phase;		/* Value it last had */
+static char *seen;		/* Scratch flag for conflict analysis */
+static int *trail, ntrail, qhead;
+static int *tlim;		/* Trail length when each level started */
+static int dlevel;
+
+/* Variable activities, and a heap of them for picking guesses */
+static double *act, varinc;
+static int *heap, *hpos, nheap;
+
+/* Clauses.  Each is its size, its LBD (number of decision levels in it
+ * when learned, 0 if not learned, -1 if deleted) and its literals, the first
+ * two of which are watched. */
+static int *arena;
+static long narena, sarena;
+static int *learnts, nlearnts, slearnts, maxlearnts;
+static int **watch, *nwatch, *swatch;
+
+/* Lines waiting to be propagated */
+static int *lq, lqhead, lqn;
+static char *inq;
+
+/* Scratch space for the line propagator and explanations */
+static char *fw, *fe, *bw, *be;	/* Forward and backward block placements */
+static int *nb, *cov, *order, *ebuf, *lbuf, *lvstamp, stamp;
+static signed char *w;
+static char *canw, *canb;
+static int width;
+static bit_type *oldbit;
+
+#define FW(b,p) fw[(b)*width+(p)]
+#define FE(b,p) fe[(b)*width+(p)]
+#define BW(b,p) bw[(b)*width+(p)]
+#define BE(b,p) be[(b)*width+(p)]
+
+#define LITVAL(l) (val[(l)>>1] < 0 ? -1 : val[(l)>>1] == ((l)&1))
+
+
+/* CDCL_WANTED - Should a stalled search be handed over to clause learning?
+ * Always with -aK, if the puzzle is one we can do, and otherwise only once
+ * the search has processed CDCL_BUDGET lines.
+ */
+
+int cdcl_wanted(Puzzle *puz)
+{
+    dir_t k;
+    line_t i;
+    int b;
+
+    if (puz->found != NULL || splitting || remoting || enumlimit >= 0)
+	return 0;
+
+    if (usable < 0)
+    {
+	usable= (puz->type == PT_GRID && puz->ncolor == 2);
+	for (k= 0; usable && k < puz->nset; k++)
+	    for (i= 0; usable && i < puz->n[k]; i++)
+		for (b= 0; b < puz->clue[k][i].n; b++)
+		    if (puz->clue[k][i].length[b] == 0)
+		    {
+			usable= 0;
+			break;
+		    }
+    }
+    if (!usable) return 0;
+
+    if (mayclause) return 1;
+    return CDCL_BUDGET > 0 && nlines >= CDCL_BUDGET;
+}
+
+
+/* ------------------------- LINE PROPAGATOR -------------------------- */
+
+/* LINE_DP - Can a line with the given clue be filled in consistently with
+ * the cell values in w[] (1 black, 0 white, -1 unknown)?  If cw and cb are
+ * not NULL, also set them to tell if each cell could be white or black.
+ *
+ * FW(b,p) is true if the first b blocks fit in cells 0..p-1 with cell p-1
+ * white, and FE(b,p) if they do with block b-1 ending at cell p-1.  BW(b,p)
+ * is true if the blocks from b on fit in cells p..len-1 with cell p white,
+ * and BE(b,p) if they do with block b starting at cell p.
+ */
+
+static int line_dp(Clue *clue, line_t len, signed char *w, char *cw, char *cb)
+{
+    int n= clue->n, b, l, run;
+    line_t p, s;
+
+    /* Count the cells before each position that can't be black */
+    nb[0]= 0;
+    for (p= 0; p < len; p++)
+	nb[p+1]= nb[p] + (w[p] == 0);
+
+    FW(0,0)= 1;
+    FE(0,0)= 0;
+    for (p= 1; p <= len; p++)
+    {
+	FW(0,p)= (w[p-1] != 1 && FW(0,p-1));
+	FE(0,p)= 0;
+    }
+    for (b= 1; b <= n; b++)
+    {
+	l= clue->length[b-1];
+	FW(b,0)= FE(b,0)= 0;
+	run= 0;
+	for (p= 1; p <= len; p++)
+	{
+	    FW(b,p)= (w[p-1] != 1 && (FW(b,p-1) || FE(b,p-1)));
+	    run|= (FE(b,p)= (p >= l && nb[p] == nb[p-l] && FW(b-1,p-l)));
+	}
+	if (!run) return 0;	/* Block b-1 fits nowhere */
+    }
+    if (!FW(n,len) && !FE(n,len)) return 0;
+    if (cw == NULL) return 1;
+
+    for (b= 0; b <= n; b++)
+	BW(b,len)= BE(b,len)= 0;
+    BW(n,len)= 1;
+    for (p= len - 1; p >= 0; p--)
+    {
+	BW(n,p)= (w[p] != 1 && BW(n,p+1));
+	BE(n,p)= 0;
+	for (b= n - 1; b >= 0; b--)
+	{
+	    l= clue->length[b];
+	    BW(b,p)= (w[p] != 1 && (BW(b,p+1) || BE(b,p+1)));
+	    BE(b,p)= (p + l <= len && nb[p+l] == nb[p] && BW(b+1,p+l));
+	}
+    }
+
+    /* A cell can be white if it is between two blocks, and black if some
+     * block can be placed over it */
+    for (p= 0; p <= len; p++)
+	cov[p]= 0;
+    for (b= 0; b < n; b++)
+    {
+	l= clue->length[b];
+	for (s= 0; s + l <= len; s++)
+	    if (FW(b,s) && BE(b,s))
+	    {
+		cov[s]++;
+		cov[s+l]--;
+	    }
+    }
+    run= 0;
+    for (p= 0; p < len; p++)
+    {
+	run+= cov[p];
+	cb[p]= (run > 0);
+	cw[p]= 0;
+	for (b= 0; b <= n && !cw[p]; b++)
+	    cw[p]= ((FW(b,p) || FE(b,p)) && BW(b,p));
+    }
+    return 1;
+}
+
+
+/* ------------------------ ASSIGNMENT AND HEAP ----------------------- */
+
+static void heap_up(int i)
+{
+    int v= heap[i], par;
+
+    while (i > 0 && act[heap[par= (i-1)/2]] < act[v])
+    {
+	heap[i]= heap[par];
+	hpos[heap[i]]= i;
+	i= par;
+    }
+    heap[i]= v;
+    hpos[v]= i;
+}
+
+static void heap_down(int i)
+{
+    int v= heap[i], c;
+
+    while ((c= 2*i + 1) < nheap)
+    {
+	if (c + 1 < nheap && act[heap[c+1]] > act[heap[c]]) c++;
+	if (act[heap[c]] <= act[v]) break;
+	heap[i]= heap[c];
+	hpos[heap[i]]= i;
+	i= c;
+    }
+    heap[i]= v;
+    hpos[v]= i;
+}
+
+static void heap_insert(int v)
+{
+    heap[nheap]= v;
+    hpos[v]= nheap++;
+    heap_up(hpos[v]);
+}
+
+static int heap_pop(void)
+{
+    int v= heap[0];
+
+    hpos[v]= -1;
+    if (--nheap > 0)
+    {
+	heap[0]= heap[nheap];
+	hpos[heap[0]]= 0;
+	heap_down(0);
+    }
+    return v;
+}
+
+
+/* BUMP - A variable took part in a conflict.  Make it more likely to be
+ * guessed on.
+ */
+
+static void bump(int v)
+{
+    int i;
+
+    if ((act[v]+= varinc) > 1e100)
+    {
+	for (i= 0; i < nvar; i++)
+	    act[i]*= 1e-100;
+	varinc*= 1e-100;
+    }
+    if (hpos[v] >= 0) heap_up(hpos[v]);
+}
+
+
+/* ASSIGN - Make a literal true, for the given reason, and queue up the lines
+ * through the cell.
+ */
+
+static void assign(int lit, int why)
+{
+    int v= lit >> 1, l;
+    dir_t k;
+
+    val[v]= lit & 1;
+    level[v]= dlevel;
+    reason[v]= why;
+    tpos[v]= ntrail;
+    trail[ntrail++]= lit;
+
+    for (k= 0; k < 2; k++)
+    {
+	l= lineof[2*v+k];
+	if (!inq[l])
+	{
+	    inq[l]= 1;
+	    lq[(lqhead + lqn++) % nline]= l;
+	}
+    }
+}
+
+
+/* --------------------------- CLAUSES ------------------------------ */
+
+static void add_watch(int lit, int c)
+{
+    if (nwatch[lit] >= swatch[lit])
+    {
+	swatch[lit]= swatch[lit] ? 2*swatch[lit] : 4;
+	watch[lit]= (int *)realloc(watch[lit], swatch[lit] * sizeof(int));
+    }
+    watch[lit][nwatch[lit]++]= c;
+}
+
+
+/* ADD_CLAUSE - Store a clause of n >= 2 literals and watch the first two.
+ * Returns its index.
+ */
+
+static int add_clause(int *lits, int n, int lbd)
+{
+    int c;
+
+    if (narena + n + 2 > sarena)
+    {
+	while (narena + n + 2 > sarena) sarena*= 2;
+	arena= (int *)realloc(arena, sarena * sizeof(int));
+    }
+    c= narena;
+    arena[c]= n;
+    arena[c+1]= lbd;
+    memmove(arena + c + 2, lits, n * sizeof(int));
+    narena+= n + 2;
+
+    add_watch(lits[0], c);
+    add_watch(lits[1], c);
+
+    if (lbd > 0)
+    {
+	if (nlearnts >= slearnts)
+	{
+	    slearnts*= 2;
+	    learnts= (int *)realloc(learnts, slearnts * sizeof(int));
+	}
+	learnts[nlearnts++]= c;
+    }
+    return c;
+}
+
+
+/* PROP_CLAUSES - Literal p has just become true.  Look at the clauses
+ * watching its negation, finding them new watches, or propagating or
+ * returning them as conflicts if there are none.
+ */
+
+static int prop_clauses(int p)
+{
+    int fl= p ^ 1;
+    int *ws= watch[fl], n= nwatch[fl];
+    int i, j, k, c, sz, *lits;
+
+    for (i= j= 0; i < n; i++)
+    {
+	c= ws[i];
+	sz= arena[c];
+	lits= arena + c + 2;
+
+	/* Keep the false literal second */
+	if (lits[0] == fl)
+	{
+	    lits[0]= lits[1];
+	    lits[1]= fl;
+	}
+	if (LITVAL(lits[0]) == 1)
+	{
+	    ws[j++]= c;
+	    continue;
+	}
+
+	/* Look for a new literal to watch */
+	for (k= 2; k < sz; k++)
+	    if (LITVAL(lits[k]) != 0) break;
+	if (k < sz)
+	{
+	    lits[1]= lits[k];
+	    lits[k]= fl;
+	    add_watch(lits[1], c);
+	    continue;
+	}
+
+	/* None - the clause is unit or conflicting */
+	ws[j++]= c;
+	if (LITVAL(lits[0]) == 0)
+	{
+	    while (++i < n)
+		ws[j++]= ws[i];
+	    nwatch[fl]= j;
+	    return c;
+	}
+	assign(lits[0], c);
+    }
+    nwatch[fl]= j;
+    return NOCONF;
+}
+
+
+/* PROP_LINE - Find the cells that the current assignment forces in a line.
+ * Returns NOCONF, or the line's conflict if it can't be filled in.
+ */
+
+static int prop_line(int li)
+{
+    CLine *l= cline + li;
+    line_t p;
+    int v;
+
+    for (p= 0; p < l->len; p++)
+	w[p]= val[l->cell[p]->id];
+
+    if (!line_dp(l->clue, l->len, w, canw, canb))
+	return LINEREASON(li);
+
+    for (p= 0; p < l->len; p++)
+	if (w[p] < 0)
+	{
+	    v= l->cell[p]->id;
+	    if (!canw[p])
+		assign(LIT(v,1), LINEREASON(li));
+	    else if (!canb[p])
+		assign(LIT(v,0), LINEREASON(li));
+	}
+    return NOCONF;
+}
+
+
+/* PROPAGATE - Run the clauses and lines until nothing more is forced.
+ * Returns NOCONF or the clause or line that failed.
+ */
+
+static int propagate(void)
+{
+    int confl, li;
+
+    while (1)
+    {
+	while (qhead < ntrail)
+	    if ((confl= prop_clauses(trail[qhead++])) != NOCONF)
+		return confl;
+
+	if (lqn == 0) return NOCONF;
+	li= lq[lqhead];
+	lqhead= (lqhead + 1) % nline;
+	lqn--;
+	inq[li]= 0;
+	if ((confl= prop_line(li)) != NOCONF)
+	    return confl;
+    }
+}
+
+
+/* EXPLAIN_LINE - Give the reason that line li forced variable x, or if x is
+ * -1, that it failed, as a clause in ebuf[].  If x is given, its literal is
+ * first.  The other literals are the negations of cells in the line set
+ * before x, starting with all of them, and dropping each, latest first, if
+ * the rest are still enough.  Cells set at level 0 are always true, so they
+ * are left set but out of the clause.  Returns the clause size.
+ */
+
+static int explain_line(int li, int x)
+{
+    CLine *l= cline + li;
+    line_t p;
+    int i, j, v, no= 0, ne= 0, lim= (x >= 0) ? tpos[x] : ntrail;
+
+    for (p= 0; p < l->len; p++)
+    {
+	v= l->cell[p]->id;
+	if (v == x)
+	    w[p]= !val[v];
+	else if (val[v] >= 0 && tpos[v] < lim)
+	{
+	    w[p]= val[v];
+	    if (level[v] > 0)
+	    {
+		/* Insert into order, latest first */
+		for (j= no++; j > 0 && tpos[l->cell[order[j-1]]->id] < tpos[v];
+			j--)
+		    order[j]= order[j-1];
+		order[j]= p;
+	    }
+	}
+	else
+	    w[p]= -1;
+    }
+
+    for (i= 0; i < no; i++)
+    {
+	p= order[i];
+	w[p]= -1;
+	if (line_dp(l->clue, l->len, w, NULL, NULL))
+	    w[p]= val[l->cell[p]->id];
+    }
+
+    if (x >= 0) ebuf[ne++]= LIT(x, val[x]);
+    for (i= 0; i < no; i++)
+	if (w[p= order[i]] >= 0)
+	{
+	    v= l->cell[p]->id;
+	    ebuf[ne++]= LIT(v, !val[v]);
+	}
+    return ne;
+}
+
+
+/* REDUNDANT - Can literal q be left out of the learned clause, because the
+ * clause that set it contains nothing but literals already in the clause or
+ * true from the start?
+ */
+
+static int redundant(int q)
+{
+    int c= reason[q>>1], i, v;
+
+    if (c < 0) return 0;
+    for (i= 1; i < arena[c]; i++)
+    {
+	v= arena[c+2+i] >> 1;
+	if (!seen[v] && level[v] > 0) return 0;
+    }
+    return 1;
+}
+
+
+/* ANALYZE - Work back from a conflict to the first point on the current
+ * level through which everything leading to it passed.  Leaves the learned
+ * clause in lbuf[], with the literal to assert first and the one from the
+ * highest other level second, and returns its size.  The level to back up
+ * to and the LBD are returned through the pointers.
+ */
+
+static int analyze(int confl, int *btlevel, int *lbd)
+{
+    int pathc= 0, p= -1, idx= ntrail - 1, nl= 1;
+    int i, j, n, q, v, *lits;
+
+    do {
+	if (confl >= 0)
+	{
+	    n= arena[confl];
+	    lits= arena + confl + 2;
+	}
+	else
+	{
+	    n= explain_line(-2 - confl, p < 0 ? -1 : p >> 1);
+	    lits= ebuf;
+	}
+	for (i= (p < 0) ? 0 : 1; i < n; i++)
+	{
+	    q= lits[i];
+	    v= q >> 1;
+	    if (!seen[v] && level[v] > 0)
+	    {
+		seen[v]= 1;
+		bump(v);
+		if (level[v] >= dlevel)
+		    pathc++;
+		else
+		    lbuf[nl++]= q;
+	    }
+	}
+
+	/* Next literal on the trail that we are looking at */
+	while (!seen[trail[idx] >> 1]) idx--;
+	p= trail[idx--];
+	confl= reason[p >> 1];
+	seen[p >> 1]= 0;
+	pathc--;
+    } while (pathc > 0);
+    lbuf[0]= p ^ 1;
+
+    /* Drop literals implied by others in the clause */
+    for (i= j= 1; i < nl; i++)
+	if (!redundant(lbuf[i]))
+	    lbuf[j++]= lbuf[i];
+	else
+	    seen[lbuf[i] >> 1]= 0;
+    for (i= 1; i < nl; i++)
+	seen[lbuf[i] >> 1]= 0;
+    nl= j;
+
+    /* Put the literal from the highest level second, and count levels */
+    *btlevel= 0;
+    stamp++;
+    *lbd= 1;
+    for (i= 1; i < nl; i++)
+    {
+	v= lbuf[i] >> 1;
+	if (level[v] > *btlevel)
+	{
+	    *btlevel= level[v];
+	    q= lbuf[1]; lbuf[1]= lbuf[i]; lbuf[i]= q;
+	}
+	if (lvstamp[level[v]] != stamp)
+	{
+	    lvstamp[level[v]]= stamp;
+	    (*lbd)++;
+	}
+    }
+    return nl;
+}
+
+
+/* BACKJUMP - Undo all assignments above the given level */
+
+static void backjump(int lev)
+{
+    int i, v;
+
+    if (dlevel <= lev) return;
+    for (i= ntrail - 1; i >= tlim[lev+1]; i--)
+    {
+	v= trail[i] >> 1;
+	phase[v]= val[v];
+	val[v]= -1;
+	reason[v]= -1;
+	if (hpos[v] < 0) heap_insert(v);
+    }
+    ntrail= qhead= tlim[lev+1];
+    dlevel= lev;
+
+    /* Everything left was fully propagated before the next guess */
+    while (lqn > 0)
+    {
+	inq[lq[lqhead]]= 0;
+	lqhead= (lqhead + 1) % nline;
+	lqn--;
+    }
+}
+
+
+/* REDUCE - Called at level 0.  Throw away the half of the learned clauses
+ * spanning the most levels, except those spanning two or fewer.
+ */
+
+static int cmp_lbd(const void *a, const void *b)
+{
+    return arena[*(int *)b + 1] - arena[*(int *)a + 1];
+}
+
+static void reduce(void)
+{
+    int i, c, n, lbd;
+    long src, dst;
+
+    qsort(learnts, nlearnts, sizeof(int), cmp_lbd);
+    for (i= 0; i < nlearnts / 2; i++)
+	if (arena[learnts[i] + 1] > 2)
+	    arena[learnts[i] + 1]= -1;
+
+    /* Nothing at level 0 needs its reason any more */
+    for (i= 0; i < ntrail; i++)
+	reason[trail[i] >> 1]= -1;
+
+    /* Compact the clauses and rebuild the watches */
+    for (i= 0; i < 2*nvar; i++)
+	nwatch[i]= 0;
+    nlearnts= 0;
+    for (src= dst= 0; src < narena; src+= n + 2)
+    {
+	n= arena[src];
+	lbd= arena[src+1];
+	if (lbd < 0) continue;
+	c= dst;
+	memmove(arena + dst, arena + src, (n + 2) * sizeof(int));
+	dst+= n + 2;
+	add_watch(arena[c+2], c);
+	add_watch(arena[c+3], c);
+	if (lbd > 0) learnts[nlearnts++]= c;
+    }
+    narena= dst;
+    maxlearnts+= maxlearnts / 10;
+}
+
+
+/* SEARCH - Search for a solution from the current level 0 state.  Returns
+ * 1 with every variable assigned if one was found, 0 if there is none.
+ */
+
+static int search(void)
+{
+    int confl, n, bt, lbd, v;
+    long fails= 0;
+
+    while (1)
+    {
+	if ((confl= propagate()) != NOCONF)
+	{
+	    conflicts++;
+	    if (dlevel == 0) return 0;
+	    n= analyze(confl, &bt, &lbd);
+	    backjump(bt);
+	    if (n == 1)
+		assign(lbuf[0], -1);
+	    else
+	    {
+		assign(lbuf[0], add_clause(lbuf, n, lbd));
+		learned++;
+	    }
+	    varinc/= CDCL_DECAY;
+	    fails++;
+	}
+	else
+	{
+	    if (fails >= luby(crestarts + 1) * CDCL_RESTART_UNIT)
+	    {
+		if (VA) printf("A: CLAUSE LEARNING RESTART\n");
+		backjump(0);
+		crestarts++;
+		fails= 0;
+		if (nlearnts >= maxlearnts) reduce();
+		continue;
+	    }
+
+	    /* Guess the most active unassigned cell, as it last was */
+	    v= -1;
+	    while (nheap > 0)
+		if (val[v= heap_pop()] < 0) break;
+	    if (v < 0 || val[v] >= 0) return 1;
+	    decisions++;
+	    tlim[++dlevel]= ntrail;
+	    assign(LIT(v, phase[v]), -1);
+	}
+    }
+}
+
+
+/* ADD_BLOCK - At level 0, add a clause that rules out a solution.  Literals
+ * already false are dropped.  Returns 0 if no solution could satisfy it.
+ */
+
+static int add_block(int *lits, int n)
+{
+    int i, k;
+
+    for (i= k= 0; i < n; i++)
+	switch (LITVAL(lits[i]))
+	{
+	case 1:
+	    return 1;
+	case -1:
+	    lits[k++]= lits[i];
+	}
+    if (k == 0) return 0;
+    if (k == 1)
+	assign(lits[0], -1);
+    else
+	add_clause(lits, k, 0);
+    return 1;
+}
+
+
+/* ------------------------- INTERFACE ----------------------------- */
+
+/* INIT_CDCL - Allocate everything and load the grid's solved cells as the
+ * level 0 assignment.
+ */
+
+static void init_cdcl(Puzzle *puz, Solution *sol)
+{
+    dir_t k;
+    line_t i, j, maxlen= 0, maxn= 0;
+    int v, l;
+    Cell *cell;
+
+    nvar= puz->ncells;
+    nline= puz->n[0] + puz->n[1];
+
+    cline= (CLine *)malloc(nline * sizeof(CLine));
+    lineof= (int *)malloc(2 * nvar * sizeof(int));
+    for (k= 0, l= 0; k < 2; k++)
+	for (i= 0; i < puz->n[k]; i++, l++)
+	{
+	    cline[l].cell= sol->line[k][i];
+	    cline[l].clue= &puz->clue[k][i];
+	    cline[l].len= puz->clue[k][i].linelen;
+	    if (cline[l].len > maxlen) maxlen= cline[l].len;
+	    if (puz->clue[k][i].n > maxn) maxn= puz->clue[k][i].n;
+	    for (j= 0; j < cline[l].len; j++)
+		lineof[2*cline[l].cell[j]->id + k]= l;
+	}
+
+    width= maxlen + 1;
+    fw= (char *)malloc((maxn + 1) * width);
+    fe= (char *)malloc((maxn + 1) * width);
+    bw= (char *)malloc((maxn + 1) * width);
+    be= (char *)malloc((maxn + 1) * width);
+    nb= (int *)malloc(width * sizeof(int));
+    cov= (int *)malloc(width * sizeof(int));
+    order= (int *)malloc(width * sizeof(int));
+    ebuf= (int *)malloc(width * sizeof(int));
+    w= (signed char *)malloc(width);
+    canw= (char *)malloc(width);
+    canb= (char *)malloc(width);
+    oldbit= (bit_type *)malloc(fbit_size * sizeof(bit_type));
+
+    val= (signed char *)malloc(nvar);
+    level= (int *)malloc(nvar * sizeof(int));
+    reason= (int *)malloc(nvar * sizeof(int));
+    tpos= (int *)malloc(nvar * sizeof(int));
+    phase= (char *)calloc(nvar, 1);
+    seen= (char *)calloc(nvar, 1);
+    trail= (int *)malloc(nvar * sizeof(int));
+    tlim= (int *)malloc((nvar + 2) * sizeof(int));
+    lbuf= (int *)malloc((nvar + 1) * sizeof(int));
+    lvstamp= (int *)calloc(nvar + 2, sizeof(int));
+    act= (double *)calloc(nvar, sizeof(double));
+    heap= (int *)malloc(nvar * sizeof(int));
+    hpos= (int *)malloc(nvar * sizeof(int));
+
+    sarena= 4096;
+    arena= (int *)malloc(sarena * sizeof(int));
+    slearnts= 1024;
+    learnts= (int *)malloc(slearnts * sizeof(int));
+    watch= (int **)calloc(2 * nvar, sizeof(int *));
+    nwatch= (int *)calloc(2 * nvar, sizeof(int));
+    swatch= (int *)calloc(2 * nvar, sizeof(int));
+    maxlearnts= nvar / 2 + CDCL_LEARNTS;
+
+    lq= (int *)malloc(nline * sizeof(int));
+    inq= (char *)calloc(nline, 1);
+
+    varinc= 1.0;
+    ntrail= qhead= dlevel= 0;
+    lqhead= lqn= 0;
+    tlim[0]= 0;
+    nheap= 0;
+    for (v= 0; v < nvar; v++)
+    {
+	val[v]= -1;
+	reason[v]= -1;
+	hpos[v]= -1;
+	heap_insert(v);
+    }
+
+    /* Solved cells are the level 0 assignment.  Every line gets looked at. */
+    for (v= 0; v < nvar; v++)
+    {
+	cell= puz->idcell[v];
+	if (cell->n == 1)
+	    assign(LIT(v, bit_test(cell->bit, 1) ? 1 : 0), -1);
+    }
+    for (l= 0; l < nline; l++)
+	if (!inq[l])
+	{
+	    inq[l]= 1;
+	    lq[(lqhead + lqn++) % nline]= l;
+	}
+}
+
+
+/* APPLY - Fill the grid in with the values in v[].  If branch is true, the
+ * first change is made a branch point, so it can all be undone.
+ */
+
+static void apply(Puzzle *puz, Solution *sol, signed char *v, int branch)
+{
+    Cell *cell;
+    int id;
+
+    for (id= 0; id < nvar; id++)
+    {
+	cell= puz->idcell[id];
+	if (cell->n == 1) continue;
+	add_hist(puz, cell, branch);
+	branch= 0;
+	fbit_cpy(oldbit, cell->bit);
+	cell->n= 1;
+	fbit_setonly(cell->bit, v[id]);
+	solved_a_cell(puz, cell, 1);
+	trans_cell(puz, cell, oldbit);
+    }
+}
+
+
+/* CDCL_SOLVE - Search for solutions by clause learning, starting from the
+ * current grid with no history.  What we find is left in the grid so that
+ * main() reports it just as it would one from the ordinary search:
+ *
+ *  - If the solution needed no guesses, it is filled in without a branch
+ *    point, so it is known to be unique.
+ *  - If we aren't checking uniqueness, it is filled in after a branch point.
+ *  - With -u, we rule out the first solution found and look for another.
+ *    If there is none, the first is filled in as unique.  If there is, the
+ *    first is saved in puz->found and the second filled in.
+ *  - With -c, we rule out the goal first.  If nothing else is left, the goal
+ *    is filled in as unique, if it is a solution.  If something else is,
+ *    the goal goes in puz->found and that is filled in.
+ *
+ * Returns 0 if there is no solution.
+ */
+
+int cdcl_solve(Puzzle *puz, Solution *sol)
+{
+    signed char *first;
+    Cell *cell;
+    int v, n, l, rc;
+    long nd, nc;
+    line_t p;
+
+    if (VA) printf("A: CLAUSE LEARNING SEARCH\n");
+    ran= 1;
+    init_cdcl(puz, sol);
+
+    if (propagate() != NOCONF) return 0;
+
+    if (checksolution)
+    {
+	/* Rule out the goal, and see if anything else is left */
+	for (v= n= 0; v < nvar; v++)
+	{
+	    cell= puz->idcell[v];
+	    lbuf[n++]= LIT(v, puz->goal[cell->line[0]*puz->n[1] +
+		cell->line[1]] != 1);
+	}
+	rc= add_block(lbuf, n) && search();
+	guesses+= decisions;
+	backtracks+= conflicts;
+
+	first= (signed char *)malloc(nvar);
+	for (v= 0; v < nvar; v++)
+	{
+	    cell= puz->idcell[v];
+	    first[v]= puz->goal[cell->line[0]*puz->n[1] + cell->line[1]];
+	}
+	if (!rc)
+	{
+	    /* The goal is the only possibility.  Is it a solution? */
+	    for (l= 0; l < nline; l++)
+	    {
+		for (p= 0; p < cline[l].len; p++)
+		    w[p]= first[cline[l].cell[p]->id];
+		if (!line_dp(cline[l].clue, cline[l].len, w, NULL, NULL))
+		    return 0;
+	    }
+	    apply(puz, sol, first, 0);
+	    return 1;
+	}
+	apply(puz, sol, first, 1);
+	puz->found= solution_string(puz, sol);
+	undo(puz, sol, 0);
+	apply(puz, sol, val, 1);
+	return 1;
+    }
+
+    rc= search();
+    guesses+= decisions;
+    backtracks+= conflicts;
+    if (!rc) return 0;
+
+    if (decisions == 0)
+    {
+	apply(puz, sol, val, 0);
+	return 1;
+    }
+    if (!checkunique)
+    {
+	apply(puz, sol, val, 1);
+	return 1;
+    }
+
+    /* Some other solution must differ in one of the guesses made */
+    first= (signed char *)malloc(nvar);
+    memmove(first, val, nvar);
+    for (l= 1, n= 0; l <= dlevel; l++)
+	lbuf[n++]= trail[tlim[l]] ^ 1;
+    backjump(0);
+    nd= decisions;
+    nc= conflicts;
+    rc= add_block(lbuf, n) && search();
+    guesses+= decisions - nd;
+    backtracks+= conflicts - nc;
+    if (!rc)
+    {
+	apply(puz, sol, first, 0);
+	return 1;
+    }
+    apply(puz, sol, first, 1);
+    puz->found= solution_string(puz, sol);
+    undo(puz, sol, 0);
+    apply(puz, sol, val, 1);
+    return 1;
+}
+
+
+/* CDCL_STATS - Print statistics, if clause learning was used */
+
+void cdcl_stats(FILE *fp)
+{
+    if (!ran) return;
+    fprintf(fp,"Clause Learning: %ld conflicts, %ld decisions, %ld learned, "
+	    "%ld restarts\n", conflicts, decisions, learned, crestarts);
+}
@@ -24,18 +24,103 @@
 
 #define NICENESS /**/
 
-/* PLOD/SPRINT MODE - If both the hueristic and probing search strategies are
- * enabled, then we use a plod/sprint mode, where we start out probing.  If
- * we reach a point where PLOD_INIT probes have failed to find a contradiction
- * (or solve the puzzle), then we switch over to using heuristic search for
- * the next SPRINT_LENGTH times when logic failing stalls.  The we revert
- * to probing, until PLOD_LENGTH probes fail to find a contradiction and
- * the cycle repeats.
- */
-
-#define PLOD_INIT 40
-#define SPRINT_LENGTH 4000
-#define PLOD_LENGTH 40
+/* STRATEGY EPOCHS - If more than one search strategy is enabled (probing,
+ * heuristic guessing and contradiction search), then we start out probing,
+ * and the search is divided into epochs, each using one strategy, lasting
+ * until at least STRAT_EPOCH_LINES lines have been line solved.  After each
+ * epoch, the strategy that has been ruling out the search tree fastest,
+ * per line solved, is used for the next, except that after
+ * STRAT_EXPLORE epochs an epoch is given to the one that has gone unused
+ * longest.  The gap before the next such epoch doubles, up to
+ * STRAT_EXPLORE_MAX, each time it doesn't turn out to be the best.  Each
+ * strategy's rate of progress is a running average, where the old average
+ * is weighted by STRAT_DECAY and the latest epoch by 1-STRAT_DECAY.
+ */
+
+#define STRAT_EPOCH_LINES 16000
+#define STRAT_EXPLORE 16
+#define STRAT_EXPLORE_MAX 1024
+#define STRAT_DECAY 0.5
+
+/* RESTART UNIT - With -aR, the search is restarted from scratch after a
+ * number of backtracks given by the Luby sequence (1 1 2 1 1 2 4 1 1 2 ...)
+ * times this.
+ */
+
+#define RESTART_UNIT 1000
+
+/* TRANSPOSITION TABLE SIZE - When searching, we remember the hashes of grid
+ * states that have been shown to have no solution, so we don't search them
+ * again if we get back to them by some other path.  This is the number of
+ * states remembered.  Each takes 8 bytes.  When the table is full, new
+ * states overwrite old ones.
+ */
+
+#define TRANS_SIZE 262139
+
+/* SPLIT WAIT - In a parallel search (-aS), workers with nothing to do check
+ * for new work this often, in microseconds.
+ */
+
+#define SPLIT_WAIT 200
+
+/* WAVE MIN - With -aW, the line solver hands lines to the worker processes
+ * a wave at a time, so long as at least this many lines in one direction
+ * are waiting to be solved.  Smaller waves are solved in the main process.
+ * This is only the starting point - if waves turn out to be slower than
+ * solving the lines in the main process, the minimum is raised.
+ */
+
+#define WAVE_MIN 64
+
+/* REMOTE WAIT - A worker in a distributed search (-W) keeps trying to
+ * connect to the coordinator for this many seconds before giving up.
+ */
+
+#define REMOTE_WAIT 30
+
+/* GROUP LOOK - When the search stalls, we check if the unsolved cells of the
+ * group we are guessing in have come apart into independent groups.  To keep
+ * the cost of that down, we only look again once the line solver has gone
+ * through about this many times as many cells as the group has.
+ */
+
+#define GROUP_LOOK 256
+
+/* PORTFOLIO - The algorithm settings raced against each other by the -p
+ * flag, as they would be given after -a.  -p<n> uses just the first n.
+ */
+
+#define PORTFOLIO {"LHEGPID", "LHEGD", "LHEPID", "LHEGPIDP4", "LHEGPIDC", \
+		   "LHEGPIDG3", "LHEGDG7"}
+
+/* AUTO_RULES - The table used by -aA to pick algorithms, as described in
+ * auto.c.  Each rule gives ranges for the puzzle features, in the order
+ * cells, colors (maximum only), solved, density, slack and spread, followed by
+ * the algorithms to use.  The first rule that matches is used, and the last
+ * is used if none do.  Puzzles the line solver hardly dents do better just
+ * probing, with the heuristic candidates too if the lines are loose.
+ */
+
+#define AUTO_RULES { \
+    {0,LONG_MAX, 99, 0.0,0.1, 0.0,1.0, 0.3,1.0, 0.0,1.0, "LHEGPIDP4"}, \
+    {0,LONG_MAX, 99, 0.0,0.1, 0.0,1.0, 0.0,1.0, 0.0,1.0, "LHEPID"}, \
+    {0,LONG_MAX, 99, 0.0,1.0, 0.0,1.0, 0.0,1.0, 0.0,1.0, "LHEGPID"}}
+
+/* CLAUSE LEARNING - The clause learning search described in cdcl.c is used
+ * from the start with -aK.  Otherwise, a search of a black and white puzzle
+ * is handed over to it once CDCL_BUDGET lines have been line solved, which
+ * takes around ten seconds.  Set CDCL_BUDGET to 0 to never do that.  It
+ * restarts after a number of conflicts given by the Luby sequence times
+ * CDCL_RESTART_UNIT, decays variable activities by CDCL_DECAY at each
+ * conflict, and keeps about CDCL_LEARNTS learned clauses (plus one for every
+ * two cells), a number that grows by a tenth each time half are discarded.
+ */
+
+#define CDCL_BUDGET 10000000L
+#define CDCL_RESTART_UNIT 100
+#define CDCL_DECAY 0.95
+#define CDCL_LEARNTS 2000
 
 /* DUMP FILE - IF DUMP_FILE is defined, a copy of the input is dumped to that
  * file before starting.  Mostly useful for debugging CGI versions of the
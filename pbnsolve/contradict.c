@@ -21,6 +21,15 @@ dir_t cont_dir;
 line_t cont_line;
 
 
+/* For each (cell,color) tested without finding a contradiction, we remember
+ * the rows and columns that the test changed.  If they haven't changed since,
+ * it would come out the same again, so we skip it.
+ */
+static Reach *memo= NULL;
+
+#define MEMO(puz,cell,c) memo[(cell)->id * (puz)->ncolor + (c)]
+
+
 #ifdef LINEWATCH
 #define WL(k,i) (puz->clue[k][i].watch)
 #define WC(i,j) (puz->clue[0][i].watch || puz->clue[1][j].watch)
@@ -29,6 +38,99 @@ line_t cont_line;
 #define WC(i,j) 0
 #endif
 
+/* CONTRADICT_WORKER - In a worker process, claim cells from the shared task
+ * list, which holds spiral indices, and test each color of each one for a
+ * contradiction, until we run out or find one that ends the search.
+ */
+
+void contradict_worker(Puzzle *puz, Solution *sol, WorkSlot *slot)
+{
+    Cell *cell;
+    color_t c;
+    int a, rc;
+
+    if (sol->spiral == NULL)
+    	make_spiral(sol);
+
+    slot->best= -1;
+    while ((a= claim_task()) >= 0)
+    {
+	cell= sol->spiral[worktask[a]];
+	for (c= 0; c < puz->ncolor; c++)
+	{
+	    if (!may_be(cell, c)) continue;
+
+	    guess_cell(puz,sol,cell,c);
+	    rc= logic_solve(puz, sol, 1);
+	    undo(puz,sol,0);
+
+	    if (rc < 0 || (rc > 0 && !checkunique))
+	    {
+		slot->best= a;
+		slot->bestc= c;
+		slot->bestval= rc;
+		stop_task(a);
+		break;
+	    }
+	}
+	if (c < puz->ncolor) break;
+    }
+}
+
+
+/* CONTRADICT_PARALLEL - Have the workers test all the cells from spiral
+ * index <n> up to, but not including, <nlast>.  Returns the spiral index of
+ * the first cell on which they found something, or <nlast> if there was
+ * none.  Since all cells before that one have been tested, the caller can
+ * carry on from there exactly as if it had tested them itself.  If the
+ * something was a contradiction, <*cp> is set to the color that caused it.
+ * Otherwise it is set to -1, and the caller will have to redo the cell to
+ * get the solution a worker stumbled on.
+ */
+
+static int contradict_parallel(Puzzle *puz, Solution *sol,
+	int n, int nlast, int *cp)
+{
+    Cell *cell;
+    color_t c;
+    int ntask= 0, a, w;
+
+    *cp= -1;
+
+    init_workers(puz, sol);
+
+    for ( ; n != nlast; n= (sol->spiral[n+1] == NULL) ? 0 : n+1)
+    {
+	cell= sol->spiral[n];
+	if (cell->n < 2 ||
+	    count_neighbors(sol, cell->line[D_ROW], cell->line[D_COL]) < 1)
+	    continue;
+	worktask[ntask++]= n;
+    }
+    if (ntask == 0) return nlast;
+
+    run_workers(puz, sol, WCMD_CONTRADICT, ntask);
+
+    /* Count the tests on the cells that found nothing, which is all that
+     * were done before the first that found something */
+    for (a= 0; a < workhead->stop && a < ntask; a++)
+	for (c= 0; c < puz->ncolor; c++)
+	    if (may_be(sol->spiral[worktask[a]], c)) contratests++;
+
+    if (a >= ntask) return nlast;
+
+    for (w= 0; w < nworkers; w++)
+	if (workslot[w].best == a && workslot[w].bestval < 0)
+	{
+	    /* Count the tests on this cell up to the one that failed */
+	    for (c= 0; c <= workslot[w].bestc; c++)
+		if (may_be(sol->spiral[worktask[a]], c)) contratests++;
+	    *cp= workslot[w].bestc;
+	}
+    return worktask[a];
+}
+
+
 /* Do a depth-limited search for contradictions on every vaguely interesting
  * cell on the grid.  If one is found, set that cells, put jobs for them on
  * the job list, and return -1, unless we should happen to complete the
@@ -38,11 +140,13 @@ line_t cont_line;
 
 int contradict(Puzzle *puz, Solution *sol)
 {
-    line_t i,j, nlast;
-    static line_t n= -1;
+    line_t i,j;
+    int nlast;
+    static int n= -1;
     color_t c;
     Cell *cell;
-    int rc;
+    Reach *m;
+    int rc, h0;
     int oldhintlog= hintlog;
     hintlog= 0;
 
@@ -52,6 +156,14 @@ int contradict(Puzzle *puz, Solution *sol)
     if (sol->spiral == NULL)
     	make_spiral(sol);
 
+    if (memo == NULL)
+    {
+	memo= (Reach *)malloc(puz->ncells * puz->ncolor * sizeof(Reach));
+	for (rc= puz->ncells * puz->ncolor - 1; rc >= 0; rc--)
+	    memo[rc].r1= -1;
+	init_linehash(puz, sol);
+    }
+
     /* Point nlast to the last cell we'd process if we were going to proces
      * all cells.  If we've run before, then that is whatever cell we
      * processed on the last call.  We'll then start processing with that
@@ -60,6 +172,40 @@ int contradict(Puzzle *puz, Solution *sol)
     nlast= ((n == -1) ? puz->ncells-1 : n);
     if (sol->spiral[++n] == NULL) n= 0;
 
+    /* With workers, let them find the first cell with a contradiction.
+     * Our own line solver state may differ from theirs, so rather than
+     * redoing their test we just mark the guess as wrong, which is all that
+     * backtracking from the contradiction would do anyway.  When writing
+     * hints we do it all ourselves, since we need to log the implications.
+     */
+    if (nworkers > 0 && !isworker && !oldhintlog)
+    {
+	n= contradict_parallel(puz, sol, n, nlast, &rc);
+	if (n != nlast && rc >= 0)
+	{
+	    cell= sol->spiral[n];
+	    c= rc;
+	    contrafound++;
+	    if (VC)
+		printf("C: CONTRADICTION ON (%d,%d)%d\n",
+			cell->line[D_ROW],cell->line[D_COL],c);
+	    guess_cell(puz,sol,cell,c);
+	    if (backtrack(puz,sol))
+	    {
+		fprintf(stderr, "Failed to Backtrack after finding"
+		    " a contradiction\n");
+		exit(1);
+	    }
+	    if (VB)
+	    {
+		print_solution(stdout,puz,sol);
+		dump_history(stdout, puz, VV);
+	    }
+	    hintlog= oldhintlog;
+	    return -1;
+	}
+    }
+
     while(n != nlast)
     {
 	cell= sol->spiral[n];
@@ -75,11 +221,21 @@ int contradict(Puzzle *puz, Solution *sol)
 	{
 	    if (may_be(cell, c))
 	    {
+		/* Skip it if nothing it depends on has changed since it last
+		 * failed */
+		m= &MEMO(puz,cell,c);
+		if (reach_same(m))
+		{
+		    contraskips++;
+		    continue;
+		}
+
 		/* Found a cell - go do contradiction on it */
 		if (VC || VB || WC(i,j))
 		    printf("C: ==== TRYING (%d,%d) COLOR %d ====\n", i,j,c);
 		contratests++;
 
+		h0= puz->nhist;
 		guess_cell(puz,sol,cell,c);
 		rc= logic_solve(puz, sol, 1);
 
@@ -99,7 +255,9 @@ int contradict(Puzzle *puz, Solution *sol)
 		    /* No contradiction found - learned nothing - undo it */
 		    if (VC)
 			printf("C: NO CONTRADICTION ON (%d,%d)%d\n",i,j,c);
+		    if (rc == 0) reach_mark(puz, m, h0);
 		    undo(puz,sol,0);
+		    if (rc == 0) reach_seal(m);
 		}
 		else if (rc < 0)
 		{
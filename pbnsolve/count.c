@@ -0,0 +1,273 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Solution Counting
+ *
+ * With the -N flag, instead of stopping after one or two solutions, we find
+ * all of them, up to some limit.  Normally each solution is printed as it is
+ * found, as a single line giving the color of each cell, row by row.  This
+ * just runs the normal search over and over, backtracking from each solution
+ * found to look for the next.
+ *
+ * With -b we only count them.  That can be done much faster, because often
+ * the unsolved cells of a stalled puzzle fall into separate groups that
+ * share no lines with each other.  Each group can be settled without
+ * affecting any other, so the number of solutions is just the product of
+ * the number of ways each group can be filled in.  A puzzle with twenty
+ * separate two-way ambiguities has a million solutions, but we only need to
+ * do forty searches to count them.
+ */
+
+#include "pbnsolve.h"
+
+int enumlimit= -1;		/* Max number of solutions to find, 0 for no
+				 * limit, -1 if not counting */
+
+static bit_type *oldbit;		/* Scratch bitstring */
+
+
+/* PRINT_SOLUTION_LINE - Print the solution in the grid as a single line of
+ * color characters, in cell id order.
+ */
+
+static void print_solution_line(FILE *fp, Puzzle *puz)
+{
+    int id;
+    color_t c;
+
+    for (id= 0; id < puz->ncells; id++)
+    {
+	for (c= 0; c < puz->ncolor; c++)
+	    if (may_be(puz->idcell[id], c)) break;
+	putc(puz->color[c].ch, fp);
+    }
+    putc('\n', fp);
+}
+
+
+/* ENUM_SOLUTIONS - Find and print every solution, up to the limit.  Returns
+ * the number found.  *more is set if we stopped at the limit with more of
+ * the search left to do.
+ */
+
+long enum_solutions(Puzzle *puz, Solution *sol, long limit, int *more)
+{
+    long n= 0;
+
+    *more= 0;
+    while (solve(puz, sol))
+    {
+	print_solution_line(stdout, puz);
+	fflush(stdout);
+	n++;
+
+	/* If we never guessed, there can be no other solution */
+	if (puz->nhist == 0) break;
+
+	if (limit > 0 && n >= limit)
+	{
+	    *more= 1;
+	    break;
+	}
+
+	if (backtrack(puz, sol)) break;
+    }
+    return n;
+}
+
+
+static double count_group(Puzzle *puz, Solution *sol, int *cells, int ncells,
+	double limit);
+
+/* COUNT_CELLS - Count the ways the given cells can be filled in, given what
+ * is in the grid now.  The cells must share no lines with any other unsolved
+ * cells.  Counts at or above the limit are returned as the limit.
+ */
+
+static double count_cells(Puzzle *puz, Solution *sol, int *cells, int ncells,
+	double limit)
+{
+    int *gsize= (int *)malloc(ncells * sizeof(int));
+    int ngroup, g, start;
+    double total= 1.0, n;
+
+    ngroup= split_groups(puz, cells, ncells, gsize);
+
+    for (g= start= 0; g < ngroup; start+= gsize[g++])
+    {
+	n= count_group(puz, sol, cells + start, gsize[g], limit);
+	total*= n;
+	if (total == 0) break;
+    }
+    free(gsize);
+
+    return (limit > 0 && total > limit) ? limit : total;
+}
+
+
+/* ELIMINATE - Rule out color c for the cell, because guessing it led to a
+ * contradiction.
+ */
+
+static void eliminate(Puzzle *puz, Solution *sol, Cell *cell, color_t c)
+{
+    add_hist(puz, cell, 0);
+    fbit_cpy(oldbit, cell->bit);
+    bit_clear(cell->bit, c);
+    cell->n--;
+
+    if (cell->n == 1) solved_a_cell(puz, cell, 1);
+    trans_cell(puz, cell, oldbit);
+
+    add_jobs(puz, sol, -1, cell, 0, oldbit);
+}
+
+
+/* NEXT_TO_SOLVED - Is the cell beside a solved cell or the edge of the grid?
+ * Those are the cells where probes are most likely to lead somewhere.
+ */
+
+static int next_to_solved(Puzzle *puz, Solution *sol, Cell *cell)
+{
+    dir_t k;
+    line_t j;
+    Cell **line;
+
+    for (k= 0; k < puz->nset; k++)
+    {
+	line= sol->line[k][cell->line[k]];
+	j= cell->index[k];
+	if (j == 0 || line[j-1]->n == 1 ||
+	    line[j+1] == NULL || line[j+1]->n == 1)
+	    return 1;
+    }
+    return 0;
+}
+
+
+/* COUNT_GROUP - Count the ways the given connected group of unsolved cells
+ * can be filled in.  First we probe every color of every cell in the group.
+ * Colors that lead to contradictions are eliminated, and if there are any
+ * of those we start over, since the group may have come apart.  Otherwise we
+ * guess each color of the cell whose best probe left the fewest cells
+ * unsolved, and count what is left of the group after each.  Except for
+ * eliminations, the grid is left as we found it.
+ */
+
+static double count_group(Puzzle *puz, Solution *sol, int *cells, int ncells,
+	double limit)
+{
+    Cell *cell, *best= NULL;
+    int a, rc, nleft, bestnleft= puz->ncells + 1, found= 0;
+    int *rest;
+    color_t c;
+    double total= 0.0;
+
+    for (a= 0; a < ncells; a++)
+    {
+	cell= puz->idcell[cells[a]];
+	if (cell->n < 2 || !next_to_solved(puz, sol, cell)) continue;
+	for (c= 0; c < puz->ncolor; c++)
+	{
+	    if (!may_be(cell, c)) continue;
+
+	    probes++;
+	    guess_cell(puz, sol, cell, c);
+	    rc= logic_solve(puz, sol, 0);
+	    nleft= puz->ncells - puz->nsolved;
+	    undo(puz, sol, 0);
+	    flush_jobs(puz);
+
+	    if (rc < 0)
+	    {
+		eliminate(puz, sol, cell, c);
+		if (logic_solve(puz, sol, 0) < 0) return 0.0;
+		found= 1;
+		if (cell->n < 2) break;
+		continue;
+	    }
+	    if (nleft < bestnleft)
+	    {
+		best= cell;
+		bestnleft= nleft;
+	    }
+	}
+    }
+    if (found) return count_cells(puz, sol, cells, ncells, limit);
+    if (best == NULL) return 1.0;
+
+    rest= (int *)malloc(ncells * sizeof(int));
+    for (c= 0; c < puz->ncolor; c++)
+    {
+	if (!may_be(best, c)) continue;
+
+	guesses++;
+	guess_cell(puz, sol, best, c);
+	if (logic_solve(puz, sol, 0) >= 0)
+	{
+	    memcpy(rest, cells, ncells * sizeof(int));
+	    total+= count_cells(puz, sol, rest, ncells,
+		limit > 0 ? limit - total : 0);
+	}
+	undo(puz, sol, 0);
+	flush_jobs(puz);
+	backtracks++;
+
+	if (limit > 0 && total >= limit) break;
+    }
+    free(rest);
+
+    return total;
+}
+
+
+/* COUNT_SOLUTIONS - Count the solutions, up to the limit, without finding
+ * each one.  Counts at or above the limit are returned as the limit.
+ */
+
+double count_solutions(Puzzle *puz, Solution *sol, long limit)
+{
+    int *cells;
+    int id, rc;
+    double n;
+
+    if (puz->ncolor < 2) return 1.0;
+
+    rc= logic_solve(puz, sol, 0);
+    if (rc < 0) return 0.0;
+    if (rc > 0 || !maybacktrack) return 1.0;
+
+    /* Once we start guessing, line solving is all we do, and it is worth
+     * caching line solutions, as in solve() */
+    if (maylinesolve) mayexhaust= 0;
+    if (maycache && !cachelines)
+    {
+	cachelines= 1;
+	init_cache(puz);
+    }
+
+    oldbit= (bit_type *)malloc(fbit_size * sizeof(bit_type));
+    alloc_groups(puz);
+
+    cells= (int *)malloc(puz->ncells * sizeof(int));
+    for (id= 0; id < puz->ncells; id++)
+	cells[id]= id;
+    n= count_cells(puz, sol, cells, puz->ncells, (double)limit);
+
+    free(cells);
+    free(oldbit);
+    free_groups(puz);
+    return n;
+}
@@ -249,15 +249,15 @@ void dump_backtrack(FILE *fp, Puzzle *puz, Solution *sol)
 #define GRID(i,j) grid[i*puz->n[D_COL]+j]
 
     /* Count the number of items to be printed */
-    for (k= puz->nhist-1, n= 0; k > 0 && !HIST(puz,k)->branch; k--, n++)
+    for (k= puz->nhist-1, n= 0; k > 0 && k != LASTBRANCH(puz); k--, n++)
 	;
 
     for (k= puz->nhist-1; k > 0; k--)
     {
 	Hist *h= HIST(puz, k);
-	if (h->branch) break;
-	line_t i= h->cell->line[D_ROW];
-	line_t j= h->cell->line[D_COL];
+	if (k == LASTBRANCH(puz)) break;
+	line_t i= HISTCELL(puz,h)->line[D_ROW];
+	line_t j= HISTCELL(puz,h)->line[D_COL];
 	int canbe= -1;
 	int cb= 0;
 	cantbe[cb]= '\0';
@@ -266,7 +266,7 @@ void dump_backtrack(FILE *fp, Puzzle *puz, Solution *sol)
 	if ((bit= GRID(i,j)) == NULL)
 	{
 	    GRID(i,j)= bit= malloc(sizeof(bit_type)*fbit_size);
-	    fbit_cpy(bit, h->cell->bit);
+	    fbit_cpy(bit, HISTCELL(puz,h)->bit);
 	}
 
 	/* See what has changed */
@@ -413,7 +413,7 @@ void dump_history(FILE *fp, Puzzle *puz, int full)
 {
     Hist *h;
     int i;
-    int nbranch= 0;
+    int b= 0;
 
     for (i= 0; i < puz->nhist; i++)
     {
@@ -421,12 +421,13 @@ void dump_history(FILE *fp, Puzzle *puz, int full)
     	if (full)
 	{
 	    fprintf(fp,"Cell ");
-	    print_coord(fp,puz,h->cell);
+	    print_coord(fp,puz,HISTCELL(puz,h));
 	    fprintf(fp," was '");
 	    dump_bits(fp, puz, h->bit);
-	    fprintf(fp,h->branch ? "' BRANCH\n" : "'\n");
+	    fprintf(fp,(b < puz->nbranch && puz->branch[b] == i) ?
+		"' BRANCH\n" : "'\n");
 	}
-	if (h->branch) nbranch++;
+	if (b < puz->nbranch && puz->branch[b] == i) b++;
     }
-    fprintf(fp,"History Length=%d Branches=%d\n",puz->nhist,nbranch);
+    fprintf(fp,"History Length=%d Branches=%d\n",puz->nhist,puz->nbranch);
 }
@@ -28,21 +28,45 @@
 
 extern bit_type *oldval;
 
-/* SCRATCHPAD - This is a two dimensional array of size (n x ncolor),
- * which stores information about a row or a column.  The array is initialized
- * to all zero. A zero means that it has not been shown that that cell can be
- * that color.  The macro PAD(p,i,c) references the value for cell i, color
- * c in pad p.
+/* SCRATCHPADS - These store information about rows and columns.  Each pad
+ * element is an array of ncolor bytes for one cell.  The pads are cleared to
+ * all zero.  A zero means that it has not been shown that that cell can be
+ * that color.  There is one pad for the current row, and one pad with
+ * all the columns, column j starting at element j*nrows.  The macro
+ * PAD(p,o,i,c) references the value for cell i, color c in the line
+ * starting at offset o in pad p.  The pads are kept from call to call.
  */
 
-#define PAD(p,i,c) p[(i)*puz->ncolor + (c)]
+static Pad *rowpad= NULL, *colpad= NULL;
+static bit_type *realbit= NULL, *oldbit= NULL;
+
+#define PAD(p,o,i,c) (((byte *)pad_elem(p,(o)+(i)))[c])
+
+
+/* Make the scratch pads if we don't have them yet, otherwise clear them */
+
+static void init_pads(Puzzle *puz)
+{
+    if (rowpad == NULL)
+    {
+	realbit= (bit_type *) malloc(fbit_size * sizeof(bit_type));
+	oldbit= (bit_type *) malloc(fbit_size * sizeof(bit_type));
+	rowpad= new_pad(puz->n[D_COL], puz->ncolor);
+	colpad= new_pad(puz->n[D_COL] * puz->n[D_ROW], puz->ncolor);
+    }
+    else
+    {
+	clear_pad(rowpad);
+	clear_pad(colpad);
+    }
+}
 
 
 /* Given a solution, mark it into the given scratch pad.  This will be used to
  * avoid redundant checks in the future. i=row, j=column
  */
 
-void mark_soln(Puzzle *puz, byte *p, line_t *pos, line_t *bcl,
+void mark_soln(Puzzle *puz, Pad *p, int o, line_t *pos, line_t *bcl,
 	line_t i, line_t j, dir_t d)
 {
     /* d=0=D_ROW i=row index j=col index  KEEP i fixed, move j */
@@ -62,19 +86,188 @@ void mark_soln(Puzzle *puz, byte *p, line_t *pos, line_t *bcl,
     for (ic= 0; ic < clue->n; ic++)
     {
 	/* Mark white space before the block */
-	while (ir < pos[ic])
-	    PAD(p,ir++,0)= 1;
+	for (; ir < pos[ic]; ir++)
+	    PAD(p,o,ir,0)= 1;
 
 	/* Mark colored cells in the block */
-	while (ir < pos[ic] + bcl[ic])
-	    PAD(p,ir++,clue->color[ic])= 1;
+	for (; ir < pos[ic] + bcl[ic]; ir++)
+	    PAD(p,o,ir,clue->color[ic])= 1;
     }
 
     /* Mark white space after the last block */
-    while (ir < puz->n[1-d])
-	PAD(p,ir++,0)= 1;
+    for (; ir < puz->n[1-d]; ir++)
+	PAD(p,o,ir,0)= 1;
+}
+
+/* EXHAUST_WORKER - In a worker process, claim rows from the shared task list
+ * and check every cell in them the same way try_everything() does, except
+ * that we don't change the grid.  Every check is made against the grid we
+ * were given, so what we find doesn't depend on which rows we got.  For each
+ * cell that loses some colors, the remaining colors go into our slot.  If a
+ * cell loses all its colors, we stop, leaving the task index in slot->best
+ * and the direction and index of the failed line in bestc and bestval.
+ * <check> is passed in slot->bestc.
+ */
+
+void exhaust_worker(Puzzle *puz, Solution *sol, WorkSlot *slot)
+{
+    line_t i, j;
+    color_t c, realn, oldn;
+    dir_t k;
+    line_t *pos, *bcl;
+    int a, off, hits= 0, check= slot->bestc;
+    Cell *cell;
+    Pad *pad;
+
+    init_pads(puz);
+
+    while ((a= claim_task()) >= 0)
+    {
+	i= worktask[a];
+	clear_pad(rowpad);
+
+    	for (j= 0; (cell= sol->line[0][i][j]) != NULL; j++)
+	{
+	    if (cell->n == 1) continue;
+
+	    fbit_cpy(oldbit, cell->bit);
+	    fbit_cpy(realbit, cell->bit);
+	    oldn= realn= cell->n;
+
+	    for (c= 0; c < puz->ncolor; c++)
+	    {
+	    	if (!bit_test(realbit,c)) continue;
+
+		cell->n= 1;
+		fbit_setonly(cell->bit, c);
+
+		for (k= 0; k < puz->nset; k++)
+		{
+		    pad= (k == D_ROW) ? rowpad : colpad;
+		    off= (k == D_ROW) ? 0 : j * puz->n[D_ROW];
+
+		    if (PAD(pad,off,(k == D_ROW) ? j : i, c))
+			continue;
+
+		    if (!left_solve(puz,sol,k,cell->line[k], 0, &pos,&bcl))
+			mark_soln(puz,pad,off,pos,bcl,i,j,k);
+		    else if (realn == 1)
+		    {
+			/* No color left for this cell - give up */
+			fbit_cpy(cell->bit, oldbit);
+			cell->n= oldn;
+			slot->best= a;
+			slot->bestc= k;
+			slot->bestval= cell->line[k];
+			slot->count[0]= hits;
+			stop_task(a);
+			return;
+		    }
+		    else
+		    {
+			bit_clear(realbit,c);
+			realn--;
+			hits++;
+			break;
+		    }
+		}
+
+		if (realn == 1 && !check) break;
+	    }
+
+	    /* Put the cell back the way it was, and report what we found */
+	    fbit_cpy(cell->bit, oldbit);
+	    cell->n= oldn;
+	    if (realn < oldn)
+	    {
+		slot->cellid[slot->nset]= cell->id;
+		fbit_cpy((slot->cellbit + slot->nset*fbit_size), realbit);
+		slot->nset++;
+	    }
+	}
+    }
+    slot->count[0]= hits;
+}
+
+
+/* TRY_PARALLEL - Have the workers check every cell, a row at a time, and then
+ * set the cells they narrowed down, adding them to the history and the job
+ * list as try_everything() does.  Return values are the same as for
+ * try_everything().
+ */
+
+static int try_parallel(Puzzle *puz, Solution *sol, int check)
+{
+    static bit_type **newbit= NULL;
+    line_t i;
+    color_t c;
+    int a, w, id, hits= 0;
+    Cell *cell;
+    Hist *h;
+    WorkSlot *slot;
+    extern dir_t cont_dir;
+    extern line_t cont_line;
+
+    init_workers(puz, sol);
+    if (newbit == NULL)
+	newbit= (bit_type **)malloc(puz->ncells * sizeof(bit_type *));
+
+    for (i= 0; i < sol->n[D_ROW]; i++)
+	worktask[i]= i;
+    for (w= 0; w < nworkers; w++)
+	workslot[w].bestc= check;
+
+    run_workers(puz, sol, WCMD_EXHAUST, sol->n[D_ROW]);
+
+    /* A contradiction in any row means the grid is bad */
+    for (w= 0; w < nworkers; w++)
+	exh_cells+= workslot[w].count[0];
+    for (w= 0; w < nworkers; w++)
+	if (workslot[w].best >= 0 && workslot[w].best == workhead->stop)
+	{
+	    if (VE) printf("E: Contradiction! Quitting.\n");
+	    cont_dir= workslot[w].bestc;
+	    cont_line= workslot[w].bestval;
+	    return -1;
+	}
+
+    /* Set the cells in id order, so the job list comes out the same no
+     * matter which worker did what */
+    memset(newbit, 0, puz->ncells * sizeof(bit_type *));
+    for (w= 0; w < nworkers; w++)
+    {
+	slot= &workslot[w];
+	for (a= 0; a < slot->nset; a++)
+	    newbit[slot->cellid[a]]= slot->cellbit + a*fbit_size;
+    }
+
+    for (id= 0; id < puz->ncells; id++)
+    {
+	if (newbit[id] == NULL) continue;
+	cell= puz->idcell[id];
+
+	if (VS||VE)
+	    for (c= 0; c < puz->ncolor; c++)
+		if (may_be(cell,c) && !bit_test(newbit[id],c))
+		    printf("%c: CELL (%d,%d) CAN'T BE COLOR %d\n",
+			VS?'S':'E', cell->line[D_ROW], cell->line[D_COL], c);
+
+	if (!(h= add_hist2(puz, cell, cell->n, cell->bit, 0)))
+	    fbit_cpy(oldval, cell->bit);
+	hits+= cell->n;
+	fbit_cpy(cell->bit, newbit[id]);
+	count_cell(puz, cell);
+	hits-= cell->n;
+	if (cell->n == 1) solved_a_cell(puz,cell,1);
+
+	trans_cell(puz, cell, h ? h->bit : oldval);
+	add_jobs(puz, sol, -1, cell, 0, h ? h->bit : oldval);
+    }
+
+    return hits;
 }
 
+
 /* TRY_EVERYTHING - Implements the check all strategy.  The original version
  * Just tried setting every cell whose color had not been determined to each
  * of it's possible colors, and then for each color doing a left_solve() on
@@ -103,26 +296,26 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
     int hits= 0, setcell, snap= 0;
     Cell *cell;
     Hist *h;
-    byte *rowpad, **colpad, *pad;
-    bit_type *realbit= (bit_type *) malloc(fbit_size * sizeof(bit_type));
+    Pad *pad;
+    int off;
     extern dir_t cont_dir;
     extern line_t cont_line;
 
     exh_runs++;
 
-    /* Make the scratch pads - one for current row, and one for each column */
-    rowpad= (byte *)calloc(puz->n[D_COL] * puz->ncolor, 1);
-    colpad= (byte **)malloc(puz->n[D_COL] * sizeof(byte *));
-    for (j= 0; j < puz->n[D_COL]; j++)
-    	colpad[j]= (byte *)calloc(puz->n[D_ROW], puz->ncolor);
-
     if (VE) printf("E: TRYING EVERYTHING check=%d\n",check);
     if (VE&&VV) print_solution(stdout, puz, sol);
 
+    /* With workers, let them do it, unless we need to log hints */
+    if (nworkers > 0 && !isworker && !hintlog)
+	return try_parallel(puz, sol, check);
+
+    init_pads(puz);
+
     for (i= 0; i < sol->n[D_ROW]; i++)
     {
 	/* Clear row pad, which we reuse for each row */
-	if (i > 0) memset(rowpad, 0, puz->n[D_COL] * puz->ncolor);
+	if (i > 0) clear_pad(rowpad);
 
     	for (j= 0; (cell= sol->line[0][i][j]) != NULL; j++)
 	{
@@ -150,13 +343,14 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
 		/* Check all lines that cross the cell */
 		for (k= 0; k < puz->nset; k++)
 		{
-		    pad= (k == D_ROW) ? rowpad : colpad[j];
+		    pad= (k == D_ROW) ? rowpad : colpad;
+		    off= (k == D_ROW) ? 0 : j * puz->n[D_ROW];
 
 		    /* If we already know that this cell being this color
 		     * does not contradict the clue for this direction, skip
 		     * ahead
 		     */
-		    if (PAD(pad,(k == D_ROW) ? j : i, c))
+		    if (PAD(pad,off,(k == D_ROW) ? j : i, c))
 			continue;
 
 		    if (!VL && VE && VV)
@@ -173,7 +367,7 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
 			 * colors for some cells we still need to check.
 			 * Mark them in the scratch pad.
 			 */
-			mark_soln(puz,pad,pos,bcl,i,j,k);
+			mark_soln(puz,pad,off,pos,bcl,i,j,k);
 		    }
 		    else
 		    {
@@ -194,6 +388,7 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
 			if (realn == 1)
 			{
 			    if (VE) printf("E: Contradiction! Quitting.\n");
+			    if (setcell) trans_cell(puz, cell, h ? h->bit : oldval);
 			    exh_cells+= hits;
 			    cont_dir= k; cont_line= cell->line[k];
 			    return -1;
@@ -221,6 +416,9 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
 			 */
 			if (realn == 1)
 			{
+			    /* Let solved_a_cell() see the color it ended up
+			     * with, not the one we were trying */
+			    fbit_cpy(cell->bit, realbit);
 			    solved_a_cell(puz,cell,1);
 			    if (!check) goto celldone;
 			}
@@ -238,15 +436,13 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
 
 	    /* If we changed anything, add crossing jobs to job list */
 	    if (setcell > 0)
+	    {
+		trans_cell(puz, cell, h ? h->bit : oldval);
 		add_jobs(puz, sol, -1, cell, 0, h ? h->bit : oldval);
+	    }
 	}
     }
 
-    /* Discard the scratchpads */
-    for (j= 0; j < puz->n[D_COL]; j++) free(colpad[j]);
-    free(colpad);
-    free(rowpad);
-
     exh_cells+= hits;
 
     return hits;
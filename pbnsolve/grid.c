@@ -39,7 +39,8 @@ Cell *new_cell(color_t ncolor)
 
 void init_solution(Puzzle *puz, Solution *sol, int set)
 {
-    line_t i, j, n;
+    line_t i, j;
+    int n;
     color_t col;
     Cell *c;
 
@@ -110,6 +111,24 @@ int count_solved(Solution *sol)
 }
 
 
+/* INDEX_CELLS - Build the puz->idcell array, so we can find the cells of the
+ * solution grid we are working on from their ids.
+ */
+
+void index_cells(Puzzle *puz, Solution *sol)
+{
+    line_t i, j;
+    Cell *cell;
+
+    if (puz->idcell == NULL)
+	puz->idcell= (Cell **)malloc(puz->ncells * sizeof(Cell *));
+
+    for (i= 0; i < sol->n[D_ROW]; i++)
+	for (j= 0; (cell= sol->line[D_ROW][i][j]) != NULL; j++)
+	    puz->idcell[cell->id]= cell;
+}
+
+
 /* NEW_SOLUTION - generate a solution structure for the given puzzle.
  * All cells start unknown.
  */
@@ -264,7 +283,8 @@ int check_nsolved(Puzzle *puz, Solution *sol)
 
 void make_spiral(Solution *sol)
 {
-    line_t i, j, n, s;
+    line_t i, j, n;
+    int s;
     line_t nc= sol->n[D_COL];
     line_t nr= sol->n[D_ROW];
 
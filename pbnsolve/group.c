@@ -0,0 +1,488 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Independent Groups
+ *
+ * The unsolved cells of a stalled puzzle often fall into separate groups
+ * that share no lines with each other, for example when they are walled off
+ * by lines that are completely solved.  Nothing done in one group can affect
+ * another.  Solution counting uses this to multiply the counts of the
+ * groups, instead of searching through every combination of them.
+ *
+ * The depth-first search uses it too.  Otherwise it doesn't know that a guess
+ * in one group can never lead to a contradiction in another.  If it mixes
+ * guesses in two groups, every dead end in one gets searched again for each
+ * way of filling in the other, and if one group can't be filled in at all,
+ * it tries every way of filling in the others before finding that out.
+ *
+ * So whenever the search stalls, if enough work has been done since we last
+ * looked, we check if the cells of the group we are guessing in have come
+ * apart.  If so, we split it into smaller groups, numbered from smallest to
+ * largest, and only ever guess in the first group that still has unsolved
+ * cells, so each is finished before the next is started.  If we back up past
+ * the first guess in a group that has never been filled in since the split,
+ * then it can't be filled in, so we back up to the last guess before the
+ * split, without trying other ways to fill in the groups before it.  Once a
+ * group has been filled in, backing up out of it is just the search looking
+ * for other ways to fill in the groups before it, which is what we want when
+ * checking uniqueness.
+ *
+ * Splits nest, so we keep a stack of them.  A split is discarded when we back
+ * up past the last guess made before it.  A split made before any guesses is
+ * never discarded.  Splitting is not done when the search is shared with
+ * other processes (-aS, -D and -W), since they wouldn't know about the
+ * groups, so those searches go without this pruning.  Nor is it done when
+ * listing all solutions, since then every way of filling in the later groups
+ * gets searched again for each way of filling in the earlier ones anyway,
+ * and putting the small groups first only makes that worse.
+ */
+
+#include "pbnsolve.h"
+
+int maydecompose= 1;	/* Search independent groups one at a time? */
+
+static int *parent= NULL;	/* Union-find forest over cell ids */
+static int *linefirst[3];	/* First unsolved cell seen in each line */
+static int *linestamp[3];	/* When linefirst was last set */
+static int stamp;
+
+typedef struct {
+    int base;		/* Number of branches when the split was made */
+    int plev, pgrp;	/* Split and group that this one split up */
+    int ngrp;		/* Number of groups */
+    int *cell;		/* Ids of the cells, group by group */
+    int *left;		/* Number of unsolved cells in each group */
+    char *done;		/* Has each group been filled in since the split? */
+} GroupSplit;
+
+static GroupSplit *gsplit= NULL;	/* Stack of splits */
+static int ngsplit= 0, sgsplit= 0;
+
+int *grplev= NULL;	/* Last split each cell is in, -1 if none */
+int *grpof;		/* Which group of that split each cell is in */
+int curlev= -1;		/* Split holding the group we are guessing in */
+int curgrp;		/* The group we are guessing in */
+
+static long lastlook= -1;	/* Value of nlines when we last looked */
+long grpsplits= 0, grpcount= 0;	/* Statistics */
+
+
+/* ALLOC_GROUPS - Allocate the scratch space used by split_groups().
+ */
+
+void alloc_groups(Puzzle *puz)
+{
+    dir_t k;
+
+    if (parent != NULL) return;
+
+    parent= (int *)malloc(puz->ncells * sizeof(int));
+    for (k= 0; k < puz->nset; k++)
+    {
+	linefirst[k]= (int *)malloc(puz->n[k] * sizeof(int));
+	linestamp[k]= (int *)calloc(puz->n[k], sizeof(int));
+    }
+}
+
+
+void free_groups(Puzzle *puz)
+{
+    dir_t k;
+
+    free(parent);
+    parent= NULL;
+    for (k= 0; k < puz->nset; k++)
+    {
+	free(linefirst[k]);
+	free(linestamp[k]);
+    }
+}
+
+
+static int find_root(int id)
+{
+    while (parent[id] != id)
+	id= parent[id]= parent[parent[id]];
+    return id;
+}
+
+
+/* JOIN_GROUPS - Given a list of cell ids, drop the ones that are solved, and
+ * join the rest that are connected through unsolved cells of shared lines
+ * into trees in the union-find forest.  Returns the number of cells left.
+ */
+
+static int join_groups(Puzzle *puz, int *cells, int ncells)
+{
+    int a, n, id, r;
+    dir_t k;
+    line_t i;
+    Cell *cell;
+
+    stamp++;
+    for (a= n= 0; a < ncells; a++)
+    {
+	cell= puz->idcell[cells[a]];
+	if (cell->n < 2) continue;
+	id= cells[n++]= cells[a];
+	parent[id]= id;
+	for (k= 0; k < puz->nset; k++)
+	{
+	    i= cell->line[k];
+	    if (linestamp[k][i] != stamp)
+	    {
+		linestamp[k][i]= stamp;
+		linefirst[k][i]= id;
+	    }
+	    else if ((r= find_root(linefirst[k][i])) != find_root(id))
+		parent[r]= find_root(id);
+	}
+    }
+    return n;
+}
+
+
+/* SPLIT_GROUPS - Given a list of cell ids, drop the ones that are solved, and
+ * sort the rest so that cells that are connected through unsolved cells of
+ * shared lines are together.  The sizes of the groups are stored in gsize.
+ * Returns the number of groups.
+ */
+
+int split_groups(Puzzle *puz, int *cells, int ncells, int *gsize)
+{
+    int a, b, n, id, r, ngroup;
+    int *root;
+
+    n= join_groups(puz, cells, ncells);
+    if (n == 0) return 0;
+
+    /* Sort cells by the root of their group.  Insertion sort is fine, as the
+     * lists are seldom long when there is more than one group. */
+    root= (int *)malloc(n * sizeof(int));
+    for (a= 0; a < n; a++)
+    {
+	id= cells[a];
+	r= find_root(id);
+	for (b= a; b > 0 && root[b-1] > r; b--)
+	{
+	    root[b]= root[b-1];
+	    cells[b]= cells[b-1];
+	}
+	root[b]= r;
+	cells[b]= id;
+    }
+
+    ngroup= 0;
+    for (a= 0; a < n; a++)
+    {
+	if (a == 0 || root[a] != root[a-1])
+	    gsize[ngroup++]= 0;
+	gsize[ngroup-1]++;
+    }
+    free(root);
+    return ngroup;
+}
+
+
+/* DROP_SPLITS - Discard any splits made after guesses we have since backed
+ * up past, and any above the given level, returning their cells to the
+ * groups they were split from.
+ */
+
+static void drop_splits(Puzzle *puz, int keep)
+{
+    GroupSplit *s;
+    int a;
+
+    while (ngsplit > 0 &&
+	    (ngsplit > keep || gsplit[ngsplit-1].base > puz->nbranch))
+    {
+	s= &gsplit[--ngsplit];
+	for (a= 0; s->cell[a] >= 0; a++)
+	{
+	    grplev[s->cell[a]]= s->plev;
+	    grpof[s->cell[a]]= s->pgrp;
+	}
+	if (curlev == ngsplit)
+	{
+	    curlev= s->plev;
+	    curgrp= s->pgrp;
+	}
+	free(s->cell);
+	free(s->left);
+	free(s->done);
+    }
+}
+
+
+/* FIND_GROUP - Mark every group with no unsolved cells as having been filled
+ * in, and find the first group of the last split that has unsolved cells.
+ * Only call this when the line solver has stalled or completed the puzzle
+ * without a contradiction.
+ */
+
+static void find_group(void)
+{
+    int l, g;
+
+    curlev= -1;
+    for (l= ngsplit - 1; l >= 0; l--)
+	for (g= 0; g < gsplit[l].ngrp; g++)
+	{
+	    if (gsplit[l].left[g] == 0)
+		gsplit[l].done[g]= 1;
+	    else if (curlev < 0)
+	    {
+		curlev= l;
+		curgrp= g;
+	    }
+	}
+}
+
+
+static int *cmpsize;
+
+static int cmp_size(const void *a, const void *b)
+{
+    int d= cmpsize[*(int *)a] - cmpsize[*(int *)b];
+    return d != 0 ? d : *(int *)a - *(int *)b;
+}
+
+
+/* TRY_SPLIT - See if the unsolved cells of the group we are guessing in (or
+ * of the whole puzzle, if there are no groups yet) have come apart, and if
+ * so, push a new split.
+ */
+
+static void try_split(Puzzle *puz)
+{
+    GroupSplit *s;
+    int *cells, *gnum, *gsize, *order, *rank, *at;
+    int n, ng, a, g, id, r;
+
+    alloc_groups(puz);
+
+    /* Collect the cells of the group */
+    cells= (int *)malloc(puz->ncells * sizeof(int));
+    if (curlev < 0)
+    {
+	for (id= n= 0; id < puz->ncells; id++)
+	    cells[n++]= id;
+    }
+    else
+    {
+	s= &gsplit[curlev];
+	for (a= n= 0; s->cell[a] >= 0; a++)
+	    if (grplev[s->cell[a]] == curlev && grpof[s->cell[a]] == curgrp)
+		cells[n++]= s->cell[a];
+    }
+    n= join_groups(puz, cells, n);
+
+    /* Usually it is all one group still */
+    r= (n > 0) ? find_root(cells[0]) : -1;
+    for (a= 1; a < n && find_root(cells[a]) == r; a++)
+	;
+    if (a >= n)
+    {
+	free(cells);
+	return;
+    }
+
+    /* Number the groups, and count their sizes */
+    gnum= (int *)malloc(puz->ncells * sizeof(int));
+    gsize= (int *)malloc(n * sizeof(int));
+    for (a= 0; a < n; a++)
+	gnum[find_root(cells[a])]= -1;
+    for (a= ng= 0; a < n; a++)
+    {
+	r= find_root(cells[a]);
+	if (gnum[r] < 0)
+	{
+	    gnum[r]= ng;
+	    gsize[ng++]= 0;
+	}
+	gsize[gnum[r]]++;
+    }
+
+    /* Renumber them from smallest to largest */
+    order= (int *)malloc(ng * sizeof(int));
+    rank= (int *)malloc(ng * sizeof(int));
+    at= (int *)malloc(ng * sizeof(int));
+    for (g= 0; g < ng; g++)
+	order[g]= g;
+    cmpsize= gsize;
+    qsort(order, ng, sizeof(int), cmp_size);
+
+    if (ngsplit >= sgsplit)
+    {
+	sgsplit= ngsplit + 8;
+	gsplit= (GroupSplit *)realloc(gsplit, sgsplit * sizeof(GroupSplit));
+    }
+    if (grplev == NULL)
+    {
+	grplev= (int *)malloc(puz->ncells * sizeof(int));
+	grpof= (int *)malloc(puz->ncells * sizeof(int));
+	for (id= 0; id < puz->ncells; id++)
+	    grplev[id]= -1;
+    }
+    s= &gsplit[ngsplit];
+    s->base= puz->nbranch;
+    s->plev= curlev;
+    s->pgrp= (curlev < 0) ? -1 : curgrp;
+    s->ngrp= ng;
+    s->cell= (int *)malloc((n + 1) * sizeof(int));
+    s->left= (int *)malloc(ng * sizeof(int));
+    s->done= (char *)calloc(ng, sizeof(char));
+
+    /* Store the cells group by group */
+    for (g= a= 0; g < ng; a+= gsize[order[g++]])
+    {
+	rank[order[g]]= g;
+	at[order[g]]= a;
+	s->left[g]= gsize[order[g]];
+    }
+    for (a= 0; a < n; a++)
+    {
+	id= cells[a];
+	g= gnum[find_root(id)];
+	s->cell[at[g]++]= id;
+	grplev[id]= ngsplit;
+	grpof[id]= rank[g];
+    }
+    s->cell[n]= -1;
+
+    if (VA) printf("A: SPLIT %d CELLS INTO %d INDEPENDENT GROUPS\n", n, ng);
+    curlev= ngsplit++;
+    curgrp= 0;
+    grpsplits++;
+    grpcount+= ng;
+
+    free(cells);
+    free(gnum);
+    free(gsize);
+    free(order);
+    free(rank);
+    free(at);
+}
+
+
+/* GROUP_PICK - Called when the search stalls and needs to guess.  Find the
+ * group to guess in.  If the line solver has gone through enough cells since
+ * we last looked, see if the group has come apart, and if so, split it.
+ */
+
+void group_pick(Puzzle *puz, Solution *sol)
+{
+    int nleft;
+
+    if (!maydecompose || maysplit || remoting || enumlimit >= 0 ||
+	    puz->type != PT_GRID)
+	return;
+
+    drop_splits(puz, ngsplit);
+    find_group();
+
+    nleft= (curlev < 0) ? puz->ncells - puz->nsolved :
+	gsplit[curlev].left[curgrp];
+    if (lastlook >= 0 && (nlines - lastlook) *
+	    (puz->n[D_ROW] + puz->n[D_COL]) / 2 < GROUP_LOOK * nleft)
+	return;
+    lastlook= nlines;
+
+    try_split(puz);
+}
+
+
+/* GROUP_FILLED - Called when the puzzle has been completed, to mark all
+ * groups as having been filled in.
+ */
+
+void group_filled(void)
+{
+    find_group();
+}
+
+
+/* GROUP_SOLVED - Called from solved_a_cell() to keep count of the unsolved
+ * cells in each group.
+ */
+
+void group_solved(Cell *cell, int way)
+{
+    int l= grplev[cell->id], g= grpof[cell->id];
+
+    for (; l >= 0; l= gsplit[l].plev)
+    {
+	gsplit[l].left[g]-= way;
+	g= gsplit[l].pgrp;
+    }
+}
+
+
+/* GROUP_AT - Return the group of the given split that a cell is in, or -1 if
+ * it isn't in any.
+ */
+
+static int group_at(int id, int lev)
+{
+    int l= grplev[id], g= grpof[id];
+
+    for (; l > lev; l= gsplit[l].plev)
+	g= gsplit[l].pgrp;
+    return (l == lev) ? g : -1;
+}
+
+
+/* GROUP_BACKJUMP - Called before backtracking from a contradiction.  If the
+ * guess we would back up to is not in the group we were guessing in, and
+ * that group has not been filled in since its split, then it can't be.  Undo
+ * all guesses since the split, so backtrack() inverts the last one before it,
+ * and check again for the group that was split.
+ */
+
+void group_backjump(Puzzle *puz, Solution *sol)
+{
+    GroupSplit *s;
+    int g;
+
+    if (ngsplit == 0) return;
+    drop_splits(puz, ngsplit);
+
+    while (curlev >= 0 && puz->nbranch > 0)
+    {
+	s= &gsplit[curlev];
+	g= group_at(HIST(puz, LASTBRANCH(puz))->id, curlev);
+	if (g == curgrp) return;
+	if (s->done[curgrp])
+	{
+	    /* Looking for other ways to fill in an earlier group */
+	    if (g >= 0) curgrp= g;
+	    return;
+	}
+
+	if (VA) printf("A: GROUP %d CAN'T BE FILLED IN - BACKING UP %d "
+		"GUESSES\n", curgrp, puz->nbranch - s->base);
+	while (puz->nbranch > s->base)
+	    undo(puz, sol, 0);
+	drop_splits(puz, curlev);
+    }
+}
+
+
+void group_stats(FILE *fp)
+{
+    if (grpsplits > 0)
+	fprintf(fp,"Group Splits: %ld, into %ld groups\n", grpsplits, grpcount);
+}
@@ -0,0 +1,323 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Implication Cache
+ *
+ * Every probe works out the full set of consequences of setting some cell
+ * to some color, and then undoes it all.  Here we save those consequences,
+ * keyed by the (cell,color) pair that was probed, so that later probe
+ * sequences can use them.
+ *
+ * An implication learned in some state of the grid remains true in every
+ * state that can be reached from it by setting more cells, because the line
+ * solver can only learn more when it is given more to start with.  So each
+ * implication is stamped with the history length at the time it was made.
+ * It stays valid until we undo past that point, or backtrack to invert the
+ * guess at that point.  Since stamps never decrease as we go forward, the
+ * implications are kept on a stack, and undo() and backtrack() just pop off
+ * any that are newer than the point they are backing up to.
+ *
+ * The implications are used in two ways:
+ *
+ *   - Before probing on a (cell,color), we check if any of its known
+ *     consequences contradict the current grid.  If so, we can eliminate that
+ *     color from the cell without running the line solver at all.
+ *
+ *   - When we do probe on or guess a (cell,color) with known consequences,
+ *     we set all those consequences directly, so the line solver has less
+ *     work to do.
+ */
+
+#include "pbnsolve.h"
+
+/* Maximum number of consequences saved, total.  If we fill up, we flush
+ * everything and start over.
+ */
+#define IMPLY_MAXITEM 500000
+
+/* A consequence - the cell changed and its final bit string */
+typedef struct {
+    int id;		/* cell->id of cell that was set */
+    bit_decl(bit,1);	/* Bit string the cell was reduced to */
+    /* Do not define any fields after 'bit'.  When we allocate memory for this
+     * data structure, we will actually be allocating more if we need longer
+     * bitstrings.
+     */
+} ImplItem;
+
+#define IMPLITEMSIZE (sizeof(ImplItem) + (fbit_size - bit_size(1))*sizeof(bit_type))
+#define IMPLITEM(i) ((ImplItem *)(((char *)implitem)+(i)*IMPLITEMSIZE))
+
+/* An implication - a set of consequences of a (cell,color) setting */
+typedef struct {
+    int key;		/* cell->id * ncolor + color */
+    int stamp;		/* puz->nhist when the implication was learned */
+    int prev;		/* Older implication with the same key, or -1 */
+    int first, n;	/* Range of our consequences in the item array */
+    long serial;	/* Value of imply_add when it was saved */
+} Implic;
+
+int mayimply= 1;		/* Is implication caching enabled? */
+long imply_add, imply_hit, imply_contra, imply_flush;
+
+static int *implindex= NULL;	/* Newest implication for each key, or -1 */
+static Implic *impl= NULL;	/* Stack of implications */
+static int nimpl, simpl;
+static ImplItem *implitem= NULL; /* Array of consequences */
+static int nitem, sitem;
+static bit_type *implold;	/* Scratch bitstring */
+
+#define IMPLKEY(puz,cell,c) ((cell)->id * (puz)->ncolor + (c))
+
+/* Find a cell by its id */
+#define IDCELL(sol,id) ((sol)->line[D_ROW][(id)/(sol)->n[D_COL]][(id)%(sol)->n[D_COL]])
+
+
+/* INIT_IMPLY - Allocate the implication index for a puzzle */
+
+void init_imply(Puzzle *puz)
+{
+    int i, n= puz->ncells * puz->ncolor;
+
+    implindex= (int *)malloc(n * sizeof(int));
+    for (i= 0; i < n; i++)
+	implindex[i]= -1;
+
+    simpl= 1024;
+    impl= (Implic *)malloc(simpl * sizeof(Implic));
+    nimpl= 0;
+
+    sitem= 8192;
+    implitem= (ImplItem *)malloc(sitem * IMPLITEMSIZE);
+    nitem= 0;
+
+    implold= (bit_type *)malloc(fbit_size * sizeof(bit_type));
+}
+
+
+/* IMPLY_FLUSH - Discard all implications */
+
+static void flush_imply(void)
+{
+    int i;
+
+    for (i= 0; i < nimpl; i++)
+	implindex[impl[i].key]= -1;
+    nimpl= 0;
+    nitem= 0;
+    imply_flush++;
+}
+
+
+/* IMPLY_TRIM - Discard all implications learned after the history was
+ * <nhist> elements long.  Called after undoing things.
+ */
+
+void imply_trim(int nhist)
+{
+    Implic *m;
+
+    if (implindex == NULL) return;
+
+    while (nimpl > 0 && (m= &impl[nimpl-1])->stamp > nhist)
+    {
+	implindex[m->key]= m->prev;
+	nitem= m->first;
+	nimpl--;
+    }
+}
+
+
+/* IMPLY_SAVE - Called after a probe of <cell> with color <c> is complete, and
+ * before it is undone.  The probe's guess was saved at history index <base>,
+ * so everything after that in the history is a consequence of it.  Returns
+ * a serial number that imply_serial() will return for as long as this stays
+ * the implication we have for <cell> and <c>, or -1 if nothing was saved.
+ */
+
+long imply_save(Puzzle *puz, Solution *sol, Cell *cell, color_t c, int base)
+{
+    Implic *m;
+    ImplItem *it;
+    Hist *h;
+    int k, n;
+
+    if (implindex == NULL) return -1;
+
+    n= puz->nhist - base - 1;
+    if (n <= 0) return -1;
+
+    /* If there isn't room, throw everything out and start over */
+    if (nitem + n > IMPLY_MAXITEM)
+	flush_imply();
+
+    if (nitem + n > sitem)
+    {
+	while (nitem + n > sitem) sitem*= 2;
+	implitem= (ImplItem *)realloc(implitem, sitem * IMPLITEMSIZE);
+    }
+    if (nimpl >= simpl)
+    {
+	simpl*= 2;
+	impl= (Implic *)realloc(impl, simpl * sizeof(Implic));
+    }
+
+    m= &impl[nimpl];
+    m->key= IMPLKEY(puz,cell,c);
+    m->stamp= base;
+    m->prev= implindex[m->key];
+    m->first= nitem;
+    m->n= n;
+    m->serial= ++imply_add;
+
+    for (k= base + 1; k < puz->nhist; k++)
+    {
+	h= HIST(puz,k);
+	it= IMPLITEM(nitem++);
+	it->id= h->id;
+	fbit_cpy(it->bit, HISTCELL(puz,h)->bit);
+    }
+
+    implindex[m->key]= nimpl++;
+    return m->serial;
+}
+
+
+/* IMPLY_SERIAL - Return the serial number of the implication we have for
+ * <cell> and <c>, or -1 if we have none.
+ */
+
+long imply_serial(Puzzle *puz, Cell *cell, color_t c)
+{
+    if (implindex == NULL || implindex[IMPLKEY(puz,cell,c)] < 0) return -1;
+    return impl[implindex[IMPLKEY(puz,cell,c)]].serial;
+}
+
+
+/* IMPLY_CHECK - Return true if the known consequences of setting <cell> to
+ * color <c> contradict the current state of the grid.
+ */
+
+int imply_check(Puzzle *puz, Solution *sol, Cell *cell, color_t c)
+{
+    Implic *m;
+    ImplItem *it;
+    Cell *cc;
+    int i;
+
+    if (implindex == NULL || implindex[IMPLKEY(puz,cell,c)] < 0) return 0;
+
+    m= &impl[implindex[IMPLKEY(puz,cell,c)]];
+    for (i= 0; i < m->n; i++)
+    {
+	it= IMPLITEM(m->first + i);
+	cc= IDCELL(sol, it->id);
+#ifdef LIMITCOLORS
+	if ((cc->bit[0] & it->bit[0]) == 0)
+#else
+	color_t z;
+	for (z= 0; z < fbit_size; z++)
+	    if (cc->bit[z] & it->bit[z]) break;
+	if (z == fbit_size)
+#endif
+	{
+	    if (VP)
+	    {
+		printf("P: (%d,%d)%d IMPLIES ", cell->line[0],cell->line[1],c);
+		print_coord(stdout,puz,cc);
+		printf(" - CONTRADICTION\n");
+	    }
+	    imply_contra++;
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+
+/* IMPLY_APPLY - We have just set <cell> to color <c>.  If we know any
+ * consequences of that, set them all now, adding them to the history and
+ * putting crossing lines on the job list.  The caller should already have
+ * used imply_check() to make sure they don't lead to a contradiction.
+ */
+
+void imply_apply(Puzzle *puz, Solution *sol, Cell *cell, color_t c)
+{
+    Implic *m;
+    ImplItem *it;
+    Cell *cc;
+    int i, changed;
+    color_t z;
+
+    if (implindex == NULL || implindex[IMPLKEY(puz,cell,c)] < 0) return;
+
+    m= &impl[implindex[IMPLKEY(puz,cell,c)]];
+    imply_hit++;
+
+    for (i= 0; i < m->n; i++)
+    {
+	it= IMPLITEM(m->first + i);
+	cc= IDCELL(sol, it->id);
+
+	/* Skip cells that already are no more than what we'd set them to */
+	changed= 0;
+	for (z= 0; z < fbit_size; z++)
+	    if (cc->bit[z] & ~it->bit[z]) changed= 1;
+	if (!changed) continue;
+
+	if (merging) merge_set(puz, cc, it->bit);
+
+	add_hist(puz, cc, 0);
+	fbit_cpy(implold, cc->bit);
+	for (z= 0; z < fbit_size; z++)
+	    cc->bit[z]&= it->bit[z];
+
+	if (puz->ncolor <= 2)
+	    cc->n= 1;
+	else
+	    count_cell(puz,cc);
+
+	if (cc->n == 1) solved_a_cell(puz, cc, 1);
+	trans_cell(puz, cc, implold);
+
+	add_jobs(puz, sol, -1, cc, 0, implold);
+    }
+}
+
+
+/* IMPLY_ELIMINATE - imply_check() has told us that <cell> cannot be color <c>.
+ * Remove that color from the cell, recording it in the history as a necessary
+ * consequence, and put the crossing lines on the job list.
+ */
+
+void imply_eliminate(Puzzle *puz, Solution *sol, Cell *cell, color_t c)
+{
+    if (VP || VS)
+    {
+	printf("%c: CELL ",VP ? 'P' : 'S');
+	print_coord(stdout,puz,cell);
+	printf(" CAN'T BE COLOR %d (IMPLIED)\n",c);
+    }
+
+    add_hist(puz, cell, 0);
+    fbit_cpy(implold, cell->bit);
+    bit_clear(cell->bit, c);
+    cell->n--;
+
+    if (cell->n == 1) solved_a_cell(puz, cell, 1);
+    trans_cell(puz, cell, implold);
+
+    add_jobs(puz, sol, -1, cell, 0, implold);
+}
@@ -190,7 +190,16 @@ void add_jobs(Puzzle *puz, Solution *sol, int except, Cell *cell,
     if (!maylinesolve) return;
 
     for (k= 0; k < puz->nset; k++)
-	if (k != except)
+	if (k == except)
+	{
+	    /* The line that set the cell needs no new job, but the coverage
+	     * arrays of its saved solutions may need updating */
+	    i= cell->line[k];
+	    j= cell->index[k];
+	    left_check(&puz->clue[k][i], j, cell->bit);
+	    right_check(&puz->clue[k][i], j, cell->bit);
+	}
+	else
 	{
 	    i= cell->line[k];
 	    j= cell->index[k];
@@ -245,6 +254,48 @@ int next_job(Puzzle *puz, dir_t *k, line_t *i, int *d)
 }
 
 
+/* Remove all jobs in direction <k> from the job list, saving their line
+ * numbers and depths in <line> and <depth>, and return how many there were.
+ * The other jobs stay on the list with their priorities unchanged.  If
+ * there are fewer than <min> jobs in that direction, nothing is removed and
+ * we return zero.
+ */
+
+int take_jobs(Puzzle *puz, dir_t k, line_t *line, int *depth, int min)
+{
+    int i, n= 0, m= 0;
+    Job *j;
+
+    for (i= 1; i <= puz->njob; i++)
+	if (puz->job[i].dir == k) n++;
+    if (n < min) return 0;
+
+    n= 0;
+    for (i= 1; i <= puz->njob; i++)
+    {
+	j= &puz->job[i];
+	if (j->dir == k)
+	{
+	    line[n]= j->n;
+	    depth[n++]= j->depth;
+	    puz->clue[k][j->n].jobindex= -1;
+	}
+	else
+	{
+	    if (++m != i) puz->job[m]= *j;
+	    puz->clue[j->dir][j->n].jobindex= m;
+	}
+    }
+
+    /* Rebuild the heap from what's left */
+    puz->njob= m;
+    for (i= m/2; i >= 1; i--)
+	heapify_jobs(puz, i);
+
+    return n;
+}
+
+
 /* Put every row and column on the job list.
  */
 
@@ -312,6 +363,21 @@ void enlarge_hist(Puzzle *puz)
 }
 
 
+/* PUSH_MARK - Push a history index onto one of the puz->branch or
+ * puz->inverted stacks, enlarging it if need be.
+ */
+
+static void push_mark(int **stack, int *n, int *s, int k)
+{
+    if (*n >= *s)
+    {
+	*s= (*s == 0) ? 64 : 2 * *s;
+	*stack= (int *)realloc(*stack, *s * sizeof(int));
+    }
+    (*stack)[(*n)++]= k;
+}
+
+
 /* Add a cell to the history.  This should be called while the cell still
  * contains it's old values.  Branch is true if this is a branch point, that
  * is, not a consequence of what has gone before, but a random guess that might
@@ -335,11 +401,14 @@ Hist *add_hist2(Puzzle *puz, Cell *cell, color_t oldn, bit_type *oldbit, int bra
     /* Make sure we have memory for the new history element */
     if (puz->nhist >= puz->shist) enlarge_hist(puz);
 
+    /* Remember where the branch points are */
+    if (branch)
+	push_mark(&puz->branch, &puz->nbranch, &puz->sbranch, puz->nhist);
+
     /* Get the new history element */
     h= HIST(puz, puz->nhist++);
 
-    h->branch= branch;
-    h->cell= cell;
+    h->id= cell->id;
     h->n= oldn;
 
     fbit_cpy(h->bit, oldbit);
@@ -356,6 +425,7 @@ Hist *add_hist2(Puzzle *puz, Cell *cell, color_t oldn, bit_type *oldbit, int bra
 int undo(Puzzle *puz, Solution *sol, int leave_branch)
 {
     Hist *h;
+    Cell *cell;
     Clue *clue;
     Cell **line;
     dir_t k;
@@ -365,6 +435,7 @@ int undo(Puzzle *puz, Solution *sol, int leave_branch)
     while (puz->nhist > 0)
     {
 	h= HIST(puz, puz->nhist-1);
+	cell= HISTCELL(puz,h);
 
 	/* Invalidate any saved positions for lines crossing undone cell.
 	 * We can't just have the fact that nhist < stamp mean the line is
@@ -374,46 +445,63 @@ int undo(Puzzle *puz, Solution *sol, int leave_branch)
 	for (k= 0; k < puz->nset; k++)
 	{
 
-	    i= h->cell->line[k];
+	    i= cell->line[k];
 	    clue= &(puz->clue[k][i]);
 	    line= sol->line[k][i];
 
 	    if ((VL && VU) || WL(*clue))
 		printf("U: CHECK %s %d", CLUENAME(puz->type,k),i);
 
-	    left_undo(puz, clue, line, h->cell->index[k], h->bit);
-	    right_undo(puz, clue, line,  h->cell->index[k], h->bit);
+	    left_undo(puz, clue, line, cell->index[k], h->bit);
+	    right_undo(puz, clue, line,  cell->index[k], h->bit);
 
 	    if ((VL && VU) || WL(*clue)) printf("\n");
 	}
 
-	is_branch= h->branch;
+	is_branch= (puz->nhist-1 == LASTBRANCH(puz));
 
 	if (!is_branch || !leave_branch)
 	{
 	    /* If undoing a solved cell, decrement completion count */
-	    if (h->cell->n == 1) solved_a_cell(puz, h->cell, -1);
+	    if (cell->n == 1) solved_a_cell(puz, cell, -1);
 
 	    /* Restore saved value */
-	    h->cell->n= h->n;
-	    fbit_cpy(h->cell->bit, h->bit);
+	    trans_cell(puz, cell, h->bit);
+	    cell->n= h->n;
+	    fbit_cpy(cell->bit, h->bit);
 
-	    if (VU || WC(h->cell))
+	    if (VU || WC(cell))
 	    {
 	    	printf("U: UNDOING CELL ");
 		for (k= 0; k < puz->nset; k++)
-		    printf(" %d",h->cell->line[k]);
+		    printf(" %d",cell->line[k]);
 		printf(" TO ");
-		dump_bits(stdout,puz,h->cell->bit);
-		printf(" (%d)\n",h->cell->n);
+		dump_bits(stdout,puz,cell->bit);
+		printf(" (%d)\n",cell->n);
 	    }
 
 	    puz->nhist--;
+	    if (is_branch) puz->nbranch--;
+
+	    /* If this was a guess we had already inverted, then both
+	     * alternatives have failed, and the grid as it was before the
+	     * guess is a dead end.
+	     */
+	    if (puz->ninverted > 0 &&
+		    puz->inverted[puz->ninverted-1] == puz->nhist)
+	    {
+		puz->ninverted--;
+		trans_save(puz);
+	    }
 	}
 
 	if (is_branch)
+	{
+	    imply_trim(puz->nhist);
 	    return 0;
+	}
     }
+    imply_trim(puz->nhist);
     return 1;
 }
 
@@ -427,6 +515,7 @@ int undo(Puzzle *puz, Solution *sol, int leave_branch)
 int backtrack(Puzzle *puz, Solution *sol)
 {
     Hist *h;
+    Cell *cell;
     color_t z, oldn, newn;
     dir_t k;
 
@@ -443,51 +532,60 @@ int backtrack(Puzzle *puz, Solution *sol)
 
     /* This will be the branch point since undo() backed us up to it */
     h= HIST(puz, puz->nhist-1);
+    cell= HISTCELL(puz,h);
 
-    if (VB || WC(h->cell))
+    if (VB || WC(cell))
     {
 	printf("B: LAST GUESS WAS ");
-	print_coord(stdout,puz,h->cell);
+	print_coord(stdout,puz,cell);
 	printf(" |");
 	dump_bits(stdout,puz,h->bit);
 	printf("| -> |");
-	dump_bits(stdout,puz,h->cell->bit);
+	dump_bits(stdout,puz,cell->bit);
 	printf("|\n");
     }
 
     /* If undoing a solved cell, uncount it */
-    if (h->cell->n == 1) solved_a_cell(puz, h->cell, -1);
+    if (cell->n == 1) solved_a_cell(puz, cell, -1);
 
     /* Reset any bits previously set */
+    trans_cell(puz, cell, h->bit);
 #ifdef LIMITCOLORS
-    h->cell->bit[0]= ((~h->cell->bit[0]) & h->bit[0]);
+    cell->bit[0]= ((~cell->bit[0]) & h->bit[0]);
 #else
     for (z= 0; z < fbit_size; z++)
-	h->cell->bit[z]= ((~h->cell->bit[z]) & h->bit[z]);
+	cell->bit[z]= ((~cell->bit[z]) & h->bit[z]);
 #endif
-    h->cell->n= h->n - h->cell->n;  /* Since the bits set in h are always
-				       a superset of those in h->cell,
+    cell->n= h->n - cell->n;  /* Since the bits set in h are always
+				       a superset of those in cell,
 				       this should always work */
 
     /* If inverted cell is solved, count it */
-    if (h->cell->n == 1) solved_a_cell(puz, h->cell, 1);
+    if (cell->n == 1) solved_a_cell(puz, cell, 1);
+    trans_cell(puz, cell, h->bit);
 
-    if (VB || WC(h->cell))
+    if (VB || WC(cell))
     {
 	printf("B: INVERTING GUESS TO |");
-	dump_bits(stdout,puz,h->cell->bit);
-	printf("| (%d)\n",h->cell->n);
+	dump_bits(stdout,puz,cell->bit);
+	printf("| (%d)\n",cell->n);
     }
 
+    /* Any implications learned since the guess was made are no longer
+     * valid now that the guess has been inverted */
+    imply_trim(puz->nhist - 1);
+
     /* Now that we've backtracked to it and inverted it, it is no
      * longer a branch point.  If there is no previous history, delete
      * this node.  Otherwise, convert it into a non-branch point.
      * Next time we backtrack we will just delete it.
      */
+    puz->nbranch--;
     if (puz->nhist == 1)
 	puz->nhist= 0;
     else
-	h->branch= 0;
+	push_mark(&puz->inverted, &puz->ninverted, &puz->sinverted,
+		puz->nhist - 1);
 
     /* Remove everything from the job list except the lines containing
      * the inverted cell.
@@ -495,7 +593,7 @@ int backtrack(Puzzle *puz, Solution *sol)
     if (maylinesolve)
     {
 	flush_jobs(puz);
-	add_jobs(puz, sol, -1, h->cell, 0, h->bit);
+	add_jobs(puz, sol, -1, cell, 0, h->bit);
     }
 
     backtracks++;
@@ -504,6 +602,147 @@ int backtrack(Puzzle *puz, Solution *sol)
 }
 
 
+/* RESTART - Undo all our guesses, and everything that followed from them,
+ * to start the search over.  Unlike when we backtrack out of an inverted
+ * guess, we don't know that the states we are leaving are dead ends, so
+ * nothing is saved in the transposition table.  Guesses inverted with no
+ * earlier guess before them are facts by now, and stay.
+ */
+
+void restart(Puzzle *puz, Solution *sol)
+{
+    puz->ninverted= 0;
+    while (!undo(puz, sol, 0))
+	;
+    flush_jobs(puz);
+}
+
+
+/* DROP_BRANCH - Our oldest branch point has been given away to be searched
+ * elsewhere.  It becomes an ordinary history entry, so when we backtrack to
+ * it we will just undo it and keep going back.
+ */
+
+static void drop_branch(Puzzle *puz)
+{
+    int b= puz->branch[0];
+    int i, j;
+
+    puz->nbranch--;
+    for (i= 0; i < puz->nbranch; i++)
+	puz->branch[i]= puz->branch[i+1];
+
+    /* Inverted guesses made before it are no longer known to lead to dead
+     * ends when we undo them, because part of their search is being done
+     * elsewhere */
+    for (i= j= 0; i < puz->ninverted; i++)
+	if (puz->inverted[i] > b)
+	    puz->inverted[j++]= puz->inverted[i];
+    puz->ninverted= j;
+}
+
+
+/* SPLIT_BRANCH - Give away the untried alternative of our oldest branch
+ * point, so some other process can search it.  The grid state it leads to
+ * is written into <grid>, an array of ncells bitstrings, by walking the
+ * history back from the current grid to the branch point and inverting the
+ * guess made there.  The branch point is then dropped.  Returns 0 if there
+ * are no branch points to give away.
+ */
+
+int split_branch(Puzzle *puz, Solution *sol, bit_type *grid)
+{
+    Hist *h;
+    int b, i;
+    color_t z;
+
+    if (puz->nbranch == 0) return 0;
+    b= puz->branch[0];
+
+    for (i= 0; i < puz->ncells; i++)
+	fbit_cpy((grid + i*fbit_size), puz->idcell[i]->bit);
+
+    for (i= puz->nhist - 1; i > b; i--)
+    {
+	h= HIST(puz, i);
+	fbit_cpy((grid + h->id*fbit_size), h->bit);
+    }
+
+    /* The guess is what the cell was just after the branch point */
+    h= HIST(puz, b);
+    for (z= 0; z < fbit_size; z++)
+	grid[h->id*fbit_size + z]= h->bit[z] & ~grid[h->id*fbit_size + z];
+
+    drop_branch(puz);
+    return 1;
+}
+
+
+/* SPLIT_PATH - Like split_branch(), but describe the untried alternative as
+ * a guess path: a list of cell ids in <id> and the colors each cell is to be
+ * limited to in <bit>, which, applied in order to the grid we started our
+ * search from, lead to it.  The path consists of the guesses before the
+ * branch point that we have already inverted, since those are known only
+ * from our search, followed by the inverted guess at the branch point.
+ * There must be room for nhist entries.  Returns the length of the path, or
+ * -1 if there are no branch points to give away.
+ */
+
+int split_path(Puzzle *puz, Solution *sol, int *id, bit_type *bit)
+{
+    static bit_type *grid= NULL;
+    Hist *h;
+    int b, i, j, n= 0;
+    color_t z;
+
+    if (puz->nbranch == 0) return -1;
+    b= puz->branch[0];
+
+    if (grid == NULL)
+	grid= (bit_type *)malloc(puz->ncells * fbit_size * sizeof(bit_type));
+    for (i= 0; i < puz->ncells; i++)
+	fbit_cpy((grid + i*fbit_size), puz->idcell[i]->bit);
+
+    /* Walk back through the history, noting what each cell on the path was
+     * just after it was set.  The path comes out backwards. */
+    j= puz->ninverted - 1;
+    for (i= puz->nhist - 1; i >= 0; i--)
+    {
+	h= HIST(puz, i);
+	while (j >= 0 && puz->inverted[j] > i) j--;
+	if (i == b)
+	{
+	    id[n]= h->id;
+	    for (z= 0; z < fbit_size; z++)
+		bit[n*fbit_size + z]= h->bit[z] & ~grid[h->id*fbit_size + z];
+	    n++;
+	}
+	else if (i < b && j >= 0 && puz->inverted[j] == i)
+	{
+	    id[n]= h->id;
+	    fbit_cpy((bit + n*fbit_size), (grid + h->id*fbit_size));
+	    n++;
+	}
+	fbit_cpy((grid + h->id*fbit_size), h->bit);
+    }
+
+    /* Put it in forward order */
+    for (i= 0, j= n - 1; i < j; i++, j--)
+    {
+	b= id[i]; id[i]= id[j]; id[j]= b;
+	for (z= 0; z < fbit_size; z++)
+	{
+	    bit_type t= bit[i*fbit_size + z];
+	    bit[i*fbit_size + z]= bit[j*fbit_size + z];
+	    bit[j*fbit_size + z]= t;
+	}
+    }
+
+    drop_branch(puz);
+    return n;
+}
+
+
 /* If the ith cell in the given line has transitioned from old to new, has
  * it made an edge in that direction, in other words, if it used to have some
  * colors in common with one of it's two neighbor cells, but doesn't any more.
@@ -381,8 +381,8 @@ void right_undo(Puzzle *puz, Clue *clue, Cell **line, line_t i, bit_type *new)
 
 	    /* Scan left from the current position through the block,
 	     * looking for another can't-be-white cell */
-	    e= clue->rpos[b];
-	    for (i--; i >= e; i--)
+	    e= clue->rpos[b] - clue->length[b];
+	    for (i--; i > e; i--)
 	    	if (!may_be_bg(line[i]))
 		{
 		    /* Found one */
@@ -1713,6 +1713,8 @@ int apply_lro(Puzzle *puz, Solution *sol, dir_t k, line_t i, int depth)
 		if (cell[j]->n == 1)
 		    solved_a_cell(puz,cell[j],1);
 
+		trans_cell(puz, cell[j], oldval);
+
 		/* Put other directions that use this cell on the job list */
 		add_jobs(puz, sol, k, cell[j], depth, oldval);
 		break;
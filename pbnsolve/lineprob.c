@@ -0,0 +1,287 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Line Probabilities
+ *
+ * For the -aG7 heuristic, we count the ways each line can be filled in that
+ * are consistent with what is known of it so far, and for each cell of the
+ * line, how many of those give the cell each color.  Dividing gives the
+ * fraction of the line's solutions in which the cell is each color.  Taking
+ * the row and column as independent, the product of those, normalized over
+ * the cell's possible colors, is our estimate of how likely it is that the
+ * cell is each color.
+ *
+ * The counting is done by dynamic programming over the positions of the
+ * blocks.  Counting from the left, we find the number of ways to place the
+ * first b blocks in the first p cells, and how many of those have block b-1
+ * ending exactly at cell p-1.  Counting from the right, we do the same for
+ * the last blocks.  The number of line solutions with block b in a given
+ * position is then the number of ways to place the blocks before it to its
+ * left times the number of ways to place the blocks after it to its right.
+ * Counts can get enormous, so we use doubles.
+ *
+ * The results for each line are saved, and only recomputed when some cell
+ * in the line has changed.  Since cells can lose colors without getting
+ * solved, trans_cell(), which is told about every change, tells us.
+ *
+ * Blotted clues aren't handled.  All colors a cell could be in a line with
+ * blotted clues are taken to be equally likely.
+ */
+
+#include "pbnsolve.h"
+
+int lineprob= 0;	/* Are we using line probabilities? */
+
+static float **prob[3];		/* Fraction of solutions of each line with
+				 * cell j of color c at [j*ncolor+c] */
+static char *stale[3];		/* Do we need to recompute it? */
+static float *cellp;		/* Probabilities returned by cell_prob() */
+
+/* Scratch space for the counting */
+static double *fwd, *fwdend;	/* Blocks 0..b-1 in cells 0..p-1 */
+static double *bwd, *bwdbeg;	/* Blocks b..n-1 in cells p..len-1 */
+static double *cover;		/* Difference array of coverage counts */
+static int *nbad;		/* Cells in 0..p-1 that can't be color c */
+static int width;		/* Row size of fwd and friends */
+
+#define FWD(b,p) fwd[(b)*width+(p)]
+#define FWDEND(b,p) fwdend[(b)*width+(p)]
+#define BWD(b,p) bwd[(b)*width+(p)]
+#define BWDBEG(b,p) bwdbeg[(b)*width+(p)]
+#define NBAD(c,p) nbad[(c)*width+(p)]
+#define COVER(c,p) cover[(c)*width+(p)]
+
+
+/* INIT_LINEPROB - Allocate memory.  Everything starts out stale. */
+
+static void init_lineprob(Puzzle *puz)
+{
+    dir_t k;
+    line_t i, maxlen= 0, maxn= 0;
+    Clue *clue;
+
+    for (k= 0; k < puz->nset; k++)
+    {
+	prob[k]= (float **)malloc(puz->n[k] * sizeof(float *));
+	stale[k]= (char *)malloc(puz->n[k] * sizeof(char));
+	for (i= 0; i < puz->n[k]; i++)
+	{
+	    clue= &puz->clue[k][i];
+	    prob[k][i]= (float *)malloc(clue->linelen * puz->ncolor *
+		    sizeof(float));
+	    stale[k][i]= 1;
+	    if (clue->linelen > maxlen) maxlen= clue->linelen;
+	    if (clue->n > maxn) maxn= clue->n;
+	}
+    }
+
+    width= maxlen + 1;
+    fwd= (double *)malloc((maxn + 1) * width * sizeof(double));
+    fwdend= (double *)malloc((maxn + 1) * width * sizeof(double));
+    bwd= (double *)malloc((maxn + 1) * width * sizeof(double));
+    bwdbeg= (double *)malloc((maxn + 1) * width * sizeof(double));
+    cover= (double *)malloc(puz->ncolor * width * sizeof(double));
+    nbad= (int *)malloc(puz->ncolor * width * sizeof(int));
+    cellp= (float *)malloc(puz->ncolor * sizeof(float));
+}
+
+
+/* LINEPROB_STALE - A cell has changed, so the lines through it will need to
+ * be recounted.
+ */
+
+void lineprob_stale(Puzzle *puz, Cell *cell)
+{
+    dir_t k;
+
+    if (stale[0] == NULL) return;
+    for (k= 0; k < puz->nset; k++)
+	stale[k][cell->line[k]]= 1;
+}
+
+
+/* COUNT_LINE - Recompute the color probabilities for one line.  Returns the
+ * number of solutions found, which should never be zero unless the line is
+ * contradictory or has blotted clues.
+ */
+
+static double count_line(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    Clue *clue= &puz->clue[k][i];
+    Cell **line= sol->line[k][i];
+    float *pr= prob[k][i];
+    line_t len= clue->linelen, n= clue->n, p, s, e, l;
+    int b;
+    color_t c, cb;
+    double total, w, run, sum;
+
+    for (b= 0; b < n; b++)
+	if (clue->length[b] == 0) goto nocount;
+
+    /* Count the cells in each prefix of the line that can't be each color */
+    for (c= 0; c < puz->ncolor; c++)
+    {
+	NBAD(c,0)= 0;
+	for (p= 0; p < len; p++)
+	    NBAD(c,p+1)= NBAD(c,p) + !may_be(line[p],c);
+    }
+
+    /* Count placements from the left */
+    FWD(0,0)= 1.0;
+    FWDEND(0,0)= 0.0;
+    for (p= 1; p <= len; p++)
+    {
+	FWD(0,p)= may_be_bg(line[p-1]) ? FWD(0,p-1) : 0.0;
+	FWDEND(0,p)= 0.0;
+    }
+    for (b= 1; b <= n; b++)
+    {
+	cb= clue->color[b-1];
+	l= clue->length[b-1];
+	for (p= 0; p <= len; p++)
+	{
+	    /* Block b-1 ending just before cell p */
+	    w= 0.0;
+	    s= p - l;
+	    if (s >= 0 && NBAD(cb,p) == NBAD(cb,s))
+	    {
+		w= FWD(b-1,s);
+		if (b > 1 && clue->color[b-2] == cb) w-= FWDEND(b-1,s);
+	    }
+	    FWDEND(b,p)= w;
+	    FWD(b,p)= w +
+		((p > 0 && may_be_bg(line[p-1])) ? FWD(b,p-1) : 0.0);
+	}
+    }
+    total= FWD(n,len);
+    if (total <= 0.0) goto nocount;
+
+    /* Count placements from the right */
+    BWD(n,len)= 1.0;
+    BWDBEG(n,len)= 0.0;
+    for (p= len - 1; p >= 0; p--)
+    {
+	BWD(n,p)= may_be_bg(line[p]) ? BWD(n,p+1) : 0.0;
+	BWDBEG(n,p)= 0.0;
+    }
+    for (b= n - 1; b >= 0; b--)
+    {
+	cb= clue->color[b];
+	l= clue->length[b];
+	for (p= len; p >= 0; p--)
+	{
+	    /* Block b starting at cell p */
+	    w= 0.0;
+	    e= p + l;
+	    if (e <= len && NBAD(cb,e) == NBAD(cb,p))
+	    {
+		w= BWD(b+1,e);
+		if (b < n - 1 && clue->color[b+1] == cb) w-= BWDBEG(b+1,e);
+	    }
+	    BWDBEG(b,p)= w;
+	    BWD(b,p)= w +
+		((p < len && may_be_bg(line[p])) ? BWD(b,p+1) : 0.0);
+	}
+    }
+
+    /* Add up the placements of each block over the cells it covers */
+    for (c= 0; c < puz->ncolor; c++)
+	for (p= 0; p <= len; p++)
+	    COVER(c,p)= 0.0;
+    for (b= 0; b < n; b++)
+    {
+	cb= clue->color[b];
+	l= clue->length[b];
+	for (s= 0; s + l <= len; s++)
+	{
+	    if (BWDBEG(b,s) == 0.0) continue;
+	    w= FWD(b,s);
+	    if (b > 0 && clue->color[b-1] == cb) w-= FWDEND(b,s);
+	    if (w == 0.0) continue;
+	    w*= BWDBEG(b,s);
+	    COVER(cb,s)+= w;
+	    COVER(cb,s+l)-= w;
+	}
+    }
+
+    /* Convert to fractions, with the background getting what is left */
+    for (c= 1; c < puz->ncolor; c++)
+    {
+	run= 0.0;
+	for (p= 0; p < len; p++)
+	{
+	    run+= COVER(c,p);
+	    COVER(c,p)= run;
+	}
+    }
+    for (p= 0; p < len; p++)
+    {
+	sum= 0.0;
+	for (c= 1; c < puz->ncolor; c++)
+	{
+	    pr[p*puz->ncolor + c]= COVER(c,p) / total;
+	    sum+= COVER(c,p);
+	}
+	pr[p*puz->ncolor]= (sum < total) ? (total - sum) / total : 0.0;
+    }
+    return total;
+
+nocount:
+    /* Can't count - take all possible colors to be equally likely */
+    for (p= 0; p < len; p++)
+	for (c= 0; c < puz->ncolor; c++)
+	    pr[p*puz->ncolor + c]= may_be(line[p],c) ? 1.0 : 0.0;
+    return 0.0;
+}
+
+
+/* CELL_PROB - Return our estimates of the probability that the given cell is
+ * each color, in an array that is reused on the next call.
+ */
+
+float *cell_prob(Puzzle *puz, Solution *sol, Cell *cell)
+{
+    dir_t k;
+    line_t i;
+    color_t c;
+    float sum;
+
+    if (stale[0] == NULL) init_lineprob(puz);
+
+    for (c= 0; c < puz->ncolor; c++)
+	cellp[c]= may_be(cell,c) ? 1.0 : 0.0;
+
+    for (k= 0; k < puz->nset; k++)
+    {
+	i= cell->line[k];
+	if (stale[k][i])
+	{
+	    count_line(puz, sol, k, i);
+	    stale[k][i]= 0;
+	}
+	for (c= 0; c < puz->ncolor; c++)
+	    cellp[c]*= prob[k][i][cell->index[k]*puz->ncolor + c];
+    }
+
+    sum= 0.0;
+    for (c= 0; c < puz->ncolor; c++)
+	sum+= cellp[c];
+    for (c= 0; c < puz->ncolor; c++)
+	if (sum > 0.0)
+	    cellp[c]/= sum;
+	else
+	    cellp[c]= may_be(cell,c) ? 1.0 / cell->n : 0.0;
+    return cellp;
+}
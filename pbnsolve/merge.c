@@ -18,7 +18,7 @@
 int merging= 0;		/* Are we currently merging? */
 int merge_no= -1;	/* Guess count.  If 0 we are on first guess for cell */
 MergeElem *merge_list= NULL; /* List of consequences of all guesses so far */
-MergeElem *mergegrid;	/* Grid of merge cells */
+Pad *mergegrid;		/* Grid of merge cells */
 
 extern bit_type *oldval;
 
@@ -27,7 +27,7 @@ extern bit_type *oldval;
 
 void init_merge(Puzzle *puz)
 {
-    mergegrid= (MergeElem *)calloc(puz->ncells, sizeof(MergeElem));
+    mergegrid= new_pad(puz->ncells, sizeof(MergeElem));
 }
 
 
@@ -58,13 +58,9 @@ void dump_merge(Puzzle *puz)
 
 void merge_cancel()
 {
-    MergeElem *m;
-
     if (VM) printf("M: MERGING CANCELED\n");
 
-    for (m= merge_list; m != NULL; m= m->next)
-	m->cell= NULL;
-
+    clear_pad(mergegrid);
     merge_list= NULL;
     merge_no= -1;
     merging= 0;
@@ -118,7 +114,7 @@ void merge_set(Puzzle *puz, Cell *cell, bit_type *bit)
     int zero;
 
     /* Get the merge element for this cell */
-    m= &mergegrid[cell->id];
+    m= (MergeElem *)pad_elem(mergegrid, cell->id);
     
     if (m->cell == NULL)
     {
@@ -256,16 +252,18 @@ int merge_check(Puzzle *puz, Solution *sol)
 
 	    if (m->cell->n == 1) solved_a_cell(puz, m->cell,1);
 
+	    trans_cell(puz, m->cell, oldval);
+
             /* Add rows/columns containing this cell to the job list */
 	    add_jobs(puz, sol, -1, m->cell, 0, oldval);
 
 	    found= 1;
 	}
-	/* Reset to unused state */
-	m->cell= NULL;
     }
     if (VM && !found) printf("M: NO MERGE CONSEQUENCES\n");
 
+    /* Reset everything to unused state */
+    clear_pad(mergegrid);
     merge_list= NULL;
     merge_no= -1;
     merging= 0;
@@ -0,0 +1,75 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Epoch-Stamped Scratch Pads
+ *
+ * Several of our algorithms need a scratch array with one element per cell
+ * that has to be all zero each time they start.  Rather than clearing the
+ * whole thing every time, which costs time proportional to the size of the
+ * grid even if we only touch a few elements, each element carries a stamp.
+ * An element is only valid if its stamp matches the pad's current epoch, so
+ * clearing the pad just means incrementing the epoch.  Stale elements are
+ * zeroed the first time they are accessed after that.
+ *
+ * Elements are accessed with the pad_elem() macro defined in pbnsolve.h.
+ */
+
+#include "pbnsolve.h"
+
+
+/* NEW_PAD - Create a pad with <nelem> elements each <elsize> bytes long.
+ * It starts out clear.
+ */
+
+Pad *new_pad(int nelem, int elsize)
+{
+    Pad *p= (Pad *)malloc(sizeof(Pad));
+
+    p->nelem= nelem;
+    p->elsize= elsize;
+    p->data= (char *)malloc(nelem * elsize);
+    p->stamp= (unsigned int *)calloc(nelem, sizeof(unsigned int));
+    p->epoch= 1;
+
+    return p;
+}
+
+
+/* CLEAR_PAD - Make every element of the pad zero again.  Only when the epoch
+ * counter wraps around do we actually have to touch the stamps.
+ */
+
+void clear_pad(Pad *p)
+{
+    if (++p->epoch == 0)
+    {
+	memset(p->stamp, 0, p->nelem * sizeof(unsigned int));
+	p->epoch= 1;
+    }
+}
+
+
+/* PAD_FRESH - Called by pad_elem() when element <i> of the pad has a stale
+ * stamp.  Zero it, stamp it, and return a pointer to it.
+ */
+
+void *pad_fresh(Pad *p, int i)
+{
+    char *e= p->data + i * p->elsize;
+
+    memset(e, 0, p->elsize);
+    p->stamp[i]= p->epoch;
+    return (void *)e;
+}
@@ -36,9 +36,9 @@ int cachelines= 0;
 int http= 0, terse= 0;
 int catch_intr= 0;
 
-long nlines, probes, guesses, backtracks, merges, nsprint, nplod;
+long nlines, probes, guesses, backtracks, merges;
 long exh_runs, exh_cells;
-long contratests, contrafound;
+long contratests, contrafound, contraskips;
 
 clock_t sclock;
 
@@ -121,15 +121,61 @@ int setalg(char ch)
 	/* Caching of linesolver results */
 	maycache= 1;
     	break;
+    case 'I':
+	/* Caching of probe implications */
+	mayimply= 1;
+    	break;
+    case 'T':
+	/* Transposition table of dead-end grid states */
+	maytrans= 1;
+    	break;
+    case 'S':
+	/* Split the search among worker processes */
+	maysplit= 1;
+    	break;
+    case 'W':
+	/* Solve waves of lines in worker processes */
+	maywave= 1;
+    	break;
+    case 'R':
+	/* Randomized restarts - dead ends are remembered across them */
+	mayrestart= 1;
+	maytrans= 1;
+    	break;
+    case 'D':
+	/* Search independent groups of cells one at a time */
+	maydecompose= 1;
+    	break;
+    case 'K':
+	/* Search by clause learning when line solving stalls */
+	mayclause= 1;
+	maybacktrack= 1;
+    	break;
+    case 'A':
+	/* Pick the algorithms automatically when line solving stalls */
+	mayauto= 1;
+	maylinesolve= 1;
+	mayexhaust= 1;
+	maybacktrack= 1;
+    	break;
     case 0:
 	/* Called to turn everything off */
 	maylinesolve= 0;
 	mayexhaust= 0;
 	maybacktrack= 0;
+	mayguess= 0;
 	mayprobe= 0;
 	mergeprobe= 0;
 	maycontradict= 0;
 	maycache= 0;
+	mayimply= 0;
+	maytrans= 0;
+	maysplit= 0;
+	maywave= 0;
+	mayrestart= 0;
+	maydecompose= 0;
+	mayauto= 0;
+	mayclause= 0;
     	break;
     default:
     	return 0;
@@ -152,8 +198,8 @@ void print_stats(FILE *fp, Puzzle *puz, clock_t eclock)
 	    exh_cells, (exh_cells == 1) ?"":"s",
 	    exh_runs, (exh_runs == 1) ?"":"es");
     if (maycontradict)
-	fprintf(fp,"Contradiction Testing: %ld tests, %ld found\n",
-	    contratests, contrafound);
+	fprintf(fp,"Contradiction Testing: %ld tests, %ld found, %ld skipped\n",
+	    contratests, contrafound, contraskips);
     if (!mayprobe)
 	fprintf(fp,"Backtracking: %ld guesses, %ld backtracks\n",
 	    guesses,backtracks);
@@ -165,13 +211,27 @@ void print_stats(FILE *fp, Puzzle *puz, clock_t eclock)
 	       "%ld backtracks\n", probes,merges,guesses,backtracks);
     if (mayprobe)
 	probe_stats();
-    if (mayprobe && mayguess)
-	fprintf(fp,"Plod cycles: %ld, Sprint cycles: %ld\n", nplod, nsprint);
+    strategy_stats(fp);
+    if (mayprobe && mayimply)
+	fprintf(fp,"Implications: %ld saved, %ld used, %ld contradictions, "
+		"%ld flushes\n", imply_add, imply_hit, imply_contra, imply_flush);
+    if (maybacktrack && maytrans)
+	fprintf(fp,"Transpositions: %ld dead ends saved, %ld found again\n",
+		trans_add, trans_hit);
     if (maycache)
 	fprintf(fp,"Cache Hits: %ld/%ld (%.1f%%) Adds: %ld  Flushes: %ld\n",
 		cache_hit, cache_req,
 		(float)(cache_req ? cache_hit*100/cache_req : 0),
 		cache_add, cache_flush);
+    if (nworkers > 0)
+	fprintf(fp,"Worker Processes: %d\n", nworkers);
+    if (mayrestart)
+	fprintf(fp,"Restarts: %ld\n", restarts);
+    group_stats(fp);
+    auto_stats(fp);
+    cdcl_stats(fp);
+    if ((nworkers > 0 && maysplit) || splits > 0)
+	fprintf(fp,"Search Splits: %ld\n", splits);
     fprintf(fp,"Processing Time: %f sec \n",
 	    (float)(eclock - sclock)/CLOCKS_PER_SEC);
 }
@@ -195,6 +255,10 @@ void intr(int sig)
 #define SN_CPU 3
 #define SN_CDEPTH 4
 #define SN_HINTLOG 5
+#define SN_WORKERS 6
+#define SN_PORTFOLIO 7
+#define SN_ENUM 8
+#define SN_SEED 9
 
 int main(int argc, char **argv)
 {
@@ -209,9 +273,10 @@ int main(int argc, char **argv)
     int cpulimit= DEFAULT_CPULIMIT;
     int i,j, vflag= 0, aflag= 0;
     int startsol= 0;	/* solution to start from, 0 means none */
+    unsigned int seed= 1; /* random number seed, for -r and -aR */
     int setformat= 0, dump= 0, statistics= 0;
     int fmt, isunique, iscomplete;
-    int totallines, rc;
+    int totallines, rc, guessed= 0, rest= 0;
     clock_t eclock;
 #ifdef DUMP_FILE
     FILE *dfp;
@@ -301,6 +366,14 @@ int main(int argc, char **argv)
 		    else
 		    	vflag= 0;
 
+		    /* -aAuto is the same as -aA */
+		    if (aflag && !strncmp(argv[i]+j, "Auto", 4))
+		    {
+			setalg('A');
+			j+= 3;
+			continue;
+		    }
+
 		    if (aflag && setalg(argv[i][j]))
 			continue;
 		    else
@@ -331,6 +404,22 @@ int main(int argc, char **argv)
 			    if (hintlogn < 0) hintlogn= 0;
 			    hintlogn= 10*hintlogn + argv[i][j] - '0';
 			    continue;
+
+			case SN_WORKERS:
+			    nworkers= 10*nworkers + argv[i][j] - '0';
+			    continue;
+
+			case SN_PORTFOLIO:
+			    nportfolio= 10*nportfolio + argv[i][j] - '0';
+			    continue;
+
+			case SN_ENUM:
+			    enumlimit= 10*enumlimit + argv[i][j] - '0';
+			    continue;
+
+			case SN_SEED:
+			    seed= 10*seed + argv[i][j] - '0';
+			    continue;
 			}
 			goto usage;
 		    }
@@ -383,6 +472,23 @@ int main(int argc, char **argv)
 		    case 'i':
 			catch_intr= 1;
 			break;
+		    case 'j':
+			setnumber= SN_WORKERS;
+			nworkers= 0;
+			break;
+		    case 'p':
+			setnumber= SN_PORTFOLIO;
+			nportfolio= 0;
+			break;
+		    case 'r':
+			setnumber= SN_SEED;
+			seed= 0;
+			randomize= 1;
+			break;
+		    case 'N':
+			setnumber= SN_ENUM;
+			enumlimit= 0;
+			break;
 		    case 'm':
 			hintlog= 1;
 			setnumber= SN_HINTLOG;
@@ -390,6 +496,14 @@ int main(int argc, char **argv)
 		    case 'u':
 			checkunique= 1;
 			break;
+		    case 'D':
+			if (argv[i][j+1] == '\0') goto usage;
+			coordaddr= &(argv[i][j+1]);
+			goto optdone;
+		    case 'W':
+			if (argv[i][j+1] == '\0') goto usage;
+			workaddr= &(argv[i][j+1]);
+			goto optdone;
 		    case 'f':
 		    	if (argv[i][j+1] != '\0')
 			{
@@ -426,7 +540,11 @@ int main(int argc, char **argv)
 		     (setnumber == SN_INDEX && pindex > 0) ||
 		     (setnumber == SN_CPU && cpulimit > 0) ||
 		     (setnumber == SN_CDEPTH && contradepth > 0) ||
-		     (setnumber == SN_HINTLOG && hintlogn > 0) )
+		     (setnumber == SN_HINTLOG && hintlogn > 0) ||
+		     (setnumber == SN_WORKERS && nworkers > 0) ||
+		     (setnumber == SN_PORTFOLIO && nportfolio > 0) ||
+		     (setnumber == SN_ENUM && enumlimit > 0) ||
+		     (setnumber == SN_SEED && seed > 0) )
 			setnumber= SN_NONE;
 	    }
 	    else if (setformat)
@@ -442,6 +560,10 @@ int main(int argc, char **argv)
 		else if (setnumber == SN_CPU) cpulimit= n;
 		else if (setnumber == SN_CDEPTH) contradepth= n;
 		else if (setnumber == SN_HINTLOG) hintlog= n;
+		else if (setnumber == SN_WORKERS) nworkers= n;
+		else if (setnumber == SN_PORTFOLIO) nportfolio= n;
+		else if (setnumber == SN_ENUM) enumlimit= n;
+		else if (setnumber == SN_SEED) seed= n;
 		setnumber= SN_NONE;
 	    }
 	    else if (filename == NULL)
@@ -451,6 +573,11 @@ int main(int argc, char **argv)
 	}
 	if (pindex < 1) pindex= 1;
 	if (hintlogn < 0) hintlogn= 10;
+	measurefeatures= statistics;
+
+	/* Restarts would just repeat themselves without some randomness */
+	if (mayrestart) randomize= 1;
+	if (randomize) srand(seed);
 
 	/* Uniqueness checking (ie, looking to see if there is another
 	 * solution if the first one we found wasn't logically arrived at)
@@ -458,6 +585,11 @@ int main(int argc, char **argv)
 	 */
 	if (!maybacktrack) checksolution= checkunique= 0;
 
+	/* When checking a goal, search away from it first, unless we were
+	 * told to use a heuristic that uses the goal some other way */
+	if (checksolution && enumlimit < 0 && !need_goal_array)
+	    goal_direct();
+
 	if (!maylinesolve && !mayexhaust)
 		fail("Need -aL or -aE to be able to solve puzzles.\n");
 
@@ -501,12 +633,17 @@ int main(int argc, char **argv)
     }
 #endif
 
+    /* Race several configurations against each other, if asked to.  Only
+     * the children return from this. */
+    if (nportfolio >= 0) run_portfolio();
+
     /* Initialize the bitstring handling code for puzzles of our size */
     fbit_init(puz->ncolor);
 
     /* preallocate some arrays */
     init_line(puz);
     if (mergeprobe) init_merge(puz);
+    if (mayprobe && mayimply) init_imply(puz);
 
     if (VA) printf("A: pbnsolve version %s\n", version);
 
@@ -549,19 +686,54 @@ int main(int argc, char **argv)
 
     if (statistics) sclock= clock();
     make_goal_array(puz);
+    index_cells(puz, sol);
     clue_init(puz, sol);
     init_jobs(puz, sol);
+    if (maybacktrack && maytrans) init_trans(puz, sol);
     if (VJ)
     {
     	puts("J: INITIAL JOBS:");
 	dump_jobs(stdout,puz);
     }
     nlines= probes= guesses= backtracks= merges= exh_runs= exh_cells= 0;
-    contratests= contrafound= nsprint= 0;
-    nplod= 1;
+    contratests= contrafound= contraskips= 0;
+
+    /* Counting or listing all solutions is done separately */
+    if (enumlimit >= 0)
+    {
+	if (terse)
+	{
+	    double n= count_solutions(puz, sol, enumlimit);
+	    printf(enumlimit > 0 && n >= enumlimit ? "%.0f+\n" : "%.0f\n", n);
+	}
+	else
+	{
+	    int more;
+	    long n= enum_solutions(puz, sol, enumlimit, &more);
+	    if (n == 0)
+		puts("NO SOLUTION");
+	    else
+		printf("%s %ld SOLUTION%s\n", more ? "STOPPED AFTER" : "FOUND",
+		    n, n == 1 ? "" : "S");
+	}
+	if (statistics)
+	    print_stats(stdout,puz,clock());
+	exit(0);
+    }
+
+    /* Workers in a distributed search never return from this */
+    if (workaddr != NULL) remote_worker(puz, sol);
+
     while (1)
     {
-	rc= solve(puz,sol);
+	if (rest)
+	    rc= split_rest(puz,sol);
+	else if (coordaddr != NULL)
+	    rc= remote_solve(puz,sol,goal,&guessed);
+	else if (maysplit)
+	    rc= split_solve(puz,sol,goal,&guessed);
+	else
+	    rc= solve(puz,sol);
 	iscomplete= rc && (puz->nsolved == puz->ncells); /* true unless -l */
 	if (!checkunique || !rc || puz->nhist == 0 || puz->found != NULL)
 	{
@@ -572,7 +744,8 @@ int main(int argc, char **argv)
 	     *  (4) a previous search found a solution.
 	     * The solution we found is unique if (3) is true and (4) is false.
 	     */
-	    isunique= (iscomplete && puz->nhist==0 && puz->found==NULL);
+	    isunique= (iscomplete && puz->nhist==0 && puz->found==NULL &&
+		!guessed);
 
 	    /* If we know the puzzle is not unique, then it is because we
 	     * previously found another solution.  If checksolution is true,
@@ -604,11 +777,15 @@ int main(int argc, char **argv)
 	}
 	/* Otherwise, there is nothing to do but to backtrack from the current
 	 * solution and then resume the search to see if we can find a
-	 * differnt one.
+	 * differnt one.  If we have workers, they search all the remaining
+	 * branches at once instead.
 	 */
 	if (VA) printf("A: FOUND ONE SOLUTION - CHECKING FOR MORE\n%s",
 	    puz->found);
-	backtrack(puz,sol);
+	if (nworkers > 0)
+	    rest= 1;
+	else
+	    backtrack(puz,sol);
     }
     if (statistics) eclock= clock();
 
@@ -636,6 +813,8 @@ int main(int argc, char **argv)
 	if (guesses == 0 && probes == 0)
 	    printf("<logic>%d</logic>\n", contrafound == 0 ? 1 : 2);
 	printf("<difficulty>%ld</difficulty>\n",nlines*100/totallines);
+	if (portconf != NULL)
+	    printf("<portfolio>-a%s</portfolio>\n", portconf);
 	puts("</data>");
     }
     else if (terse)
@@ -736,6 +915,9 @@ int main(int argc, char **argv)
 	    puts("NO SOLUTION");
     }
 
+    if (portconf != NULL && !http && !terse)
+	printf("SOLVED WITH -a%s\n", portconf);
+
     if (statistics)
 	print_stats(stdout,puz,eclock);
 
@@ -747,7 +929,7 @@ int main(int argc, char **argv)
     exit(0);
 
 usage:
-    fprintf(stderr,"usage: %s [-cdehu] [-s#] [-n#] [-x#] [=m#] [-aLEHGPM] [-vABEGJLMPUSV] [<filename>]\n",
+    fprintf(stderr,"usage: %s [-cdehu] [-s#] [-n#] [-x#] [-j#] [-p#] [-N#] [-r#] [=m#] [-D<addr>] [-W<addr>] [-aLEHGPMITSWRDAK] [-vABEGJLMPUSV] [<filename>]\n",
     	argv[0]);
     exit(1);
 }
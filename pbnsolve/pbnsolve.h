@@ -28,6 +28,15 @@ typedef short line_t;	/* a row/column number - must be signed */
 typedef char color_t;   /* a color number, an index into a color bit string */
 typedef char dir_t;     /* A direction */
 typedef char byte;	/* various small numbers */
+typedef unsigned long long zkey_t; /* a 64-bit grid hash */
+
+/* The range of rows and columns changed by some test, and a hash of them as
+ * they were when it started.  Unused if r1 is negative.  See trans.c */
+typedef struct {
+    zkey_t hash;
+    line_t r0, r1;
+    line_t c0, c1;
+} Reach;
 
 #define MAXLINE SHRT_MAX  /* Max value that can be stored in line_t */
 
@@ -60,7 +69,7 @@ typedef char byte;	/* various small numbers */
 typedef struct {
     line_t line[3];	/* 2 or 3 line numbers of this cell */
     line_t index[3];	/* 2 or 3 indexes of this cell in those lines */
-    line_t id;		/* A unique number in (0,rows*cols-1) for this cell */
+    int id;		/* A unique number in (0,rows*cols-1) for this cell */
     color_t n;		/* Number of bits set in the bit string */
     bit_decl(bit,1);	/* bit string with 1 for each possible color */
 
@@ -152,11 +161,14 @@ typedef struct {
     line_t n;		/* Index of line that needs work */
 } Job;
 
-/* History of things set, used for backtracking */
+/* History of things set, used for backtracking.  Since we read and write
+ * these constantly, we keep them small.  Cells are identified by id instead
+ * of by pointer, and which elements are branch points is recorded separately
+ * in puz->branch.
+ */
 
 typedef struct hist_list {
-    byte branch;	/* Was this a branch point? */
-    Cell *cell;		/* The cell that was set */
+    int id;		/* The id of the cell that was set */
     color_t n;		/* Old n value of cell */
     bit_decl(bit,1);	/* Old bit string of cell */
     /* Do not define any fields after 'bit'.  When we allocate memory for this
@@ -171,6 +183,12 @@ typedef struct hist_list {
 /* i-th element of the history array */
 #define HIST(puz,i) ((Hist *)(((char *)puz->history)+(i)*HISTSIZE(puz)))
 
+/* The cell a history element refers to */
+#define HISTCELL(puz,h) ((puz)->idcell[(h)->id])
+
+/* History index of the most recent branch point, or -1 if there is none */
+#define LASTBRANCH(puz) ((puz)->nbranch > 0 ? (puz)->branch[(puz)->nbranch-1] : -1)
+
 /* Probe Merge List - settings that have been made for all probes on the
  * current cell.
  */
@@ -187,6 +205,50 @@ typedef struct merge_elem {
 } MergeElem;
 
 
+/* Scratch Pad - an array of elements that can be cleared in constant time.
+ * Each element has a stamp, and is only valid if its stamp matches the
+ * epoch.  Always access elements with pad_elem(), which zeros stale ones.
+ */
+
+typedef struct {
+    char *data;			/* nelem elements of elsize bytes each */
+    unsigned int *stamp;	/* Epoch when each element was last zeroed */
+    unsigned int epoch;		/* Current epoch */
+    int nelem, elsize;
+} Pad;
+
+#define pad_elem(p,i) ((p)->stamp[i] == (p)->epoch ? \
+	(void *)((p)->data + (i)*(p)->elsize) : pad_fresh(p,i))
+
+
+/* Worker Process Shared Data - a task list shared by all workers, and one
+ * result slot for each worker.  These live in shared memory.
+ */
+
+typedef struct {
+    int ntask;			/* Number of tasks in worktask[] */
+    volatile int next;		/* Index of next task to claim */
+    volatile int stop;		/* No need to do tasks after this one */
+    int linesolve, exhaust;	/* Parent's algorithm flags for this command */
+    int contradict, guess, probe;
+    int cache;
+} WorkHead;
+
+typedef struct {
+    int best, bestc, bestval;	/* Task, color and rating of best result */
+    int nset;			/* Number of cells in cellid/cellbit arrays */
+    int *cellid;		/* Ids of cells set by best result */
+    bit_type *cellbit;		/* Values of those cells */
+    long count[5];		/* Statistics to be added into the parent's */
+} WorkSlot;
+
+#define WCMD_PROBE 'P'		/* Do probes */
+#define WCMD_SEARCH 'S'		/* Search for solutions */
+#define WCMD_CONTRADICT 'C'	/* Search for contradictions */
+#define WCMD_EXHAUST 'E'	/* Do exhaustive check */
+#define WCMD_WAVE 'W'		/* Solve a wave of lines */
+
+
 /* Puzzle definition - Describes a puzzle (not it's solution).
  *
  * Color table.  puz->color is an array of color definitions used in the
@@ -237,6 +299,11 @@ typedef struct {
     int sjob, njob;	/* Allocated and current size of job array */
     Hist *history;	/* Undo history, if any */
     int nhist,shist;	/* Number of things in history, and size of history */
+    int *branch;	/* History indices of branch points, in order */
+    int nbranch,sbranch;
+    int *inverted;	/* History indices of branch points we've inverted */
+    int ninverted,sinverted;
+    Cell **idcell;	/* Cells of the grid being solved, indexed by id */
     char *found;	/* A stringified solution we have found, if any */
     color_t *goal;	/* A goal image used by pick_color_right() */
 } Puzzle;
@@ -340,11 +407,12 @@ extern int maycontradict;
 extern int contradepth;
 extern int hintlog;
 extern int maycache, cachelines;
-extern long nsprint, nplod;
 
 /* pbnsolve.c functions */
 
 void fail(const char *fmt, ...);
+void timeout(int sig);
+int setalg(char ch);
 void hintsnapshot(Puzzle *puz, Solution *sol);
 
 /* read.c functions */
@@ -382,6 +450,7 @@ void dump_history(FILE *fp, Puzzle *puz, int full);
 Cell *new_cell(color_t ncolor);
 Solution *new_solution(Puzzle *puz);
 int count_solved(Solution *sol);
+void index_cells(Puzzle *puz, Solution *sol);
 void init_solution(Puzzle *puz, Solution *sol, int set);
 void free_solution(Solution *sol);
 void free_solution_list(SolutionList *sl);
@@ -410,19 +479,29 @@ int apply_lro(Puzzle *puz, Solution *sol, dir_t k, line_t i, int depth);
 void flush_jobs(Puzzle *puz);
 void init_jobs(Puzzle *puz, Solution *sol);
 int next_job(Puzzle *puz, dir_t *k, line_t *i, int *depth);
+int take_jobs(Puzzle *puz, dir_t k, line_t *line, int *depth, int min);
 void add_job(Puzzle *puz, dir_t k, line_t i, int depth, int bonus);
 void add_jobs(Puzzle *puz, Solution *sol, int except, Cell *cell, int depth, bit_type *old);
 Hist *add_hist(Puzzle *puz, Cell *cell, int branch);
 Hist *add_hist2(Puzzle *puz, Cell *cell, color_t oldn, bit_type *oldbit, int branch);
+int undo(Puzzle *puz, Solution *sol, int leave_branch);
 int backtrack(Puzzle *puz, Solution *sol);
+void restart(Puzzle *puz, Solution *sol);
+int split_branch(Puzzle *puz, Solution *sol, bit_type *grid);
+int split_path(Puzzle *puz, Solution *sol, int *id, bit_type *bit);
 int newedge(Puzzle *puz, Cell **line, line_t i, bit_type *old, bit_type *new);
 
 /* solve.c functions */
 extern long nlines, guesses, backtracks, probes, merges;
-extern long contratests, contrafound;
+extern long contratests, contrafound, contraskips;
+extern int maywave, mayrestart;
+extern long restarts;
+void wave_worker(Puzzle *puz, Solution *sol, WorkSlot *slot);
 void guess_cell(Puzzle *puz, Solution *sol, Cell *cell, color_t c);
 int logic_solve(Puzzle *puz, Solution *sol, int contradicting);
 int solve(Puzzle *puz, Solution *sol);
+long luby(long i);
+void strategy_stats(FILE *fp);
 
 /* score.c function */
 void make_goal_array(Puzzle *puz);
@@ -430,27 +509,39 @@ void bookkeeping_on(Puzzle *puz, Solution *sol);
 void bookkeeping_off();
 Cell *pick_a_cell(Puzzle *puz, Solution *sol);
 void solved_a_cell(Puzzle *puz, Cell *cell, int way);
+void changed_a_cell(Puzzle *puz, Cell *cell);
 extern color_t (*pick_color)(Puzzle *puz, Solution *sol, Cell *cell);
 extern float (*cell_score_1)(Puzzle *, Solution *, line_t, line_t);
 extern float (*cell_score_2)(Puzzle *, Solution *, line_t, line_t);
 int set_scoring_rule(int n, int may_override);
+extern int randomize;
+int random_tie(int n);
+extern int goal_directed;
+extern long offgoal;
+extern int need_goal_array;
+void goal_direct(void);
+color_t pick_guess_color(Puzzle *puz, Solution *sol, Cell *cell);
 
 /* probe.c functions */
 extern int probing;
-extern bit_type *probepad;
-#define propad(cell) (probepad+(cell->id)*fbit_size)
+extern Pad *probepad;
+#define propad(cell) ((bit_type *)pad_elem(probepad,(cell)->id))
 void probe_init(Puzzle *puz, Solution *sol);
+void probe_guess(Puzzle *puz, Solution *sol, Cell *cell, color_t c);
 int probe(Puzzle *puz, Solution *sol, line_t *besti, line_t *bestj, color_t *bestc);
+void probe_worker(Puzzle *puz, Solution *sol, WorkSlot *slot);
+void frontier_update(Puzzle *puz, Cell *cell, int way);
 void probe_stats(void);
-float probe_rate(void);
 int set_probing(int n);
 
 /* contradict.c functions */
 int contradict(Puzzle *puz, Solution *sol);
+void contradict_worker(Puzzle *puz, Solution *sol, WorkSlot *slot);
 
 /* exhaust.c functions */
 extern long exh_runs, exh_cells;
 int try_everything(Puzzle *puz, Solution *sol, int check);
+void exhaust_worker(Puzzle *puz, Solution *sol, WorkSlot *slot);
 
 /* http.c functions */
 char *get_query(void);
@@ -462,11 +553,109 @@ void make_clues(Puzzle *puz, Solution *sol);
 
 /* merge.c functions */
 extern int merging;
+void init_merge(Puzzle *puz);
 void merge_cancel(void);
 void merge_guess(void);
 void merge_set(Puzzle *puz, Cell *cell, bit_type *bit);
 int merge_check(Puzzle *puz, Solution *sol);
 
+/* imply.c functions */
+extern int mayimply;
+extern long imply_add, imply_hit, imply_contra, imply_flush;
+void init_imply(Puzzle *puz);
+void imply_trim(int nhist);
+long imply_save(Puzzle *puz, Solution *sol, Cell *cell, color_t c, int base);
+long imply_serial(Puzzle *puz, Cell *cell, color_t c);
+int imply_check(Puzzle *puz, Solution *sol, Cell *cell, color_t c);
+void imply_apply(Puzzle *puz, Solution *sol, Cell *cell, color_t c);
+void imply_eliminate(Puzzle *puz, Solution *sol, Cell *cell, color_t c);
+
+/* pad.c functions */
+Pad *new_pad(int nelem, int elsize);
+void clear_pad(Pad *p);
+void *pad_fresh(Pad *p, int i);
+
+/* worker.c functions */
+extern int nworkers, isworker;
+extern WorkHead *workhead;
+extern int *worktask;
+extern WorkSlot *workslot, *myslot;
+void load_grid(Puzzle *puz, Solution *sol, bit_type *grid);
+void *share_alloc(size_t size);
+void init_workers(Puzzle *puz, Solution *sol);
+void run_workers(Puzzle *puz, Solution *sol, int cmd, int ntask);
+int claim_task(void);
+void stop_task(int i);
+
+/* split.c functions */
+extern int maysplit, splitting;
+extern long splits;
+void init_split(Puzzle *puz);
+int split_solve(Puzzle *puz, Solution *sol, char *goal, int *guessed);
+int split_rest(Puzzle *puz, Solution *sol);
+void split_worker(Puzzle *puz, Solution *sol, WorkSlot *slot);
+int split_poll(Puzzle *puz, Solution *sol);
+
+/* remote.c functions */
+extern char *coordaddr, *workaddr;
+extern int remoting;
+int remote_solve(Puzzle *puz, Solution *sol, char *goal, int *guessed);
+void remote_worker(Puzzle *puz, Solution *sol);
+void remote_poll(Puzzle *puz, Solution *sol);
+
+/* count.c functions */
+extern int enumlimit;
+long enum_solutions(Puzzle *puz, Solution *sol, long limit, int *more);
+double count_solutions(Puzzle *puz, Solution *sol, long limit);
+
+/* group.c functions */
+extern int maydecompose, *grplev, *grpof, curlev, curgrp;
+void alloc_groups(Puzzle *puz);
+void free_groups(Puzzle *puz);
+int split_groups(Puzzle *puz, int *cells, int ncells, int *gsize);
+void group_pick(Puzzle *puz, Solution *sol);
+void group_filled(void);
+void group_solved(Cell *cell, int way);
+void group_backjump(Puzzle *puz, Solution *sol);
+void group_stats(FILE *fp);
+/* May we guess on this cell, given the group we are searching? */
+#define in_group(cell) (curlev < 0 || (grplev[(cell)->id] == curlev && \
+			grpof[(cell)->id] == curgrp))
+
+/* portfolio.c functions */
+extern int nportfolio;
+extern char *portconf;
+void run_portfolio(void);
+
+/* auto.c functions */
+extern int mayauto, measurefeatures;
+void auto_features(Puzzle *puz, Solution *sol);
+void auto_select(Puzzle *puz, Solution *sol);
+void auto_stats(FILE *fp);
+
+/* cdcl.c functions */
+extern int mayclause;
+int cdcl_wanted(Puzzle *puz);
+int cdcl_solve(Puzzle *puz, Solution *sol);
+void cdcl_stats(FILE *fp);
+
+/* trans.c functions */
+extern int maytrans;
+extern long trans_add, trans_hit;
+void init_trans(Puzzle *puz, Solution *sol);
+void trans_cell(Puzzle *puz, Cell *cell, bit_type *old);
+void trans_save(Puzzle *puz);
+int trans_seen(Puzzle *puz);
+void init_linehash(Puzzle *puz, Solution *sol);
+void reach_mark(Puzzle *puz, Reach *r, int h0);
+void reach_seal(Reach *r);
+int reach_same(Reach *r);
+
+/* lineprob.c functions */
+extern int lineprob;
+void lineprob_stale(Puzzle *puz, Cell *cell);
+float *cell_prob(Puzzle *puz, Solution *sol, Cell *cell);
+
 /* line_cache.c function */
 void init_cache(Puzzle *puz);
 bit_type *line_cache(Puzzle *puz,Solution *sol,dir_t k,line_t i);
@@ -0,0 +1,166 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Portfolio Solving
+ *
+ * Which algorithms work best varies a lot from puzzle to puzzle.  With the
+ * -p flag we fork off several copies of ourself after loading the puzzle,
+ * each using a different set of algorithms from the PORTFOLIO list in
+ * config.h, and let them race.  Each child's output goes into a pipe.  The
+ * first child to finish successfully wins, its output is copied to our
+ * standard output, and the rest are killed.
+ */
+
+#include "pbnsolve.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+int nportfolio= -1;		/* Number of configurations to race, -1 if off */
+char *portconf= NULL;		/* In a child, the algorithms we are using */
+
+static char *portfolio[]= PORTFOLIO;
+
+#define MAXPORTFOLIO (sizeof(portfolio)/sizeof(char *))
+
+typedef struct {
+    pid_t pid;		/* Process id of child */
+    int fd;		/* Pipe from child's standard output */
+    char *out;		/* Output read from child so far */
+    int nout, sout;
+} Racer;
+
+
+/* KILL_RACERS - Kill all children that are still running.  Each child is
+ * the leader of its own process group, so this gets any worker processes
+ * it started too.
+ */
+
+static void kill_racers(Racer *r, int n)
+{
+    int i;
+
+    for (i= 0; i < n; i++)
+	if (r[i].pid > 0)
+	{
+	    kill(-r[i].pid, SIGKILL);
+	    waitpid(r[i].pid, NULL, 0);
+	}
+}
+
+
+/* RUN_PORTFOLIO - Fork off the children.  In each child this returns, having
+ * set the algorithm flags to that child's configuration, and the child goes
+ * on to solve the puzzle.  The parent never returns.  It waits for a winner,
+ * prints its output, and exits.
+ */
+
+void run_portfolio(void)
+{
+    Racer *r;
+    struct pollfd *pfd;
+    int i, n, fd[2], status, nleft, last= -1;
+    char *a;
+
+    if (nportfolio <= 0 || nportfolio > MAXPORTFOLIO)
+	nportfolio= MAXPORTFOLIO;
+
+    r= (Racer *)calloc(nportfolio, sizeof(Racer));
+    pfd= (struct pollfd *)malloc(nportfolio * sizeof(struct pollfd));
+
+    fflush(stdout);
+    fflush(stderr);
+
+    for (i= 0; i < nportfolio; i++)
+    {
+	if (pipe(fd))
+	    fail("Could not create pipe for portfolio\n");
+
+	if ((r[i].pid= fork()) < 0)
+	    fail("Could not fork portfolio process\n");
+
+	if (r[i].pid == 0)
+	{
+	    /* Child - send output to the pipe and set up our algorithms */
+	    setpgid(0, 0);
+	    close(fd[0]);
+	    for (n= 0; n < i; n++)
+		close(r[n].fd);
+	    dup2(fd[1], 1);
+	    close(fd[1]);
+	    free(r);
+	    free(pfd);
+
+	    portconf= portfolio[i];
+	    setalg(0);
+	    for (a= portconf; *a != '\0'; a++)
+		setalg(*a);
+	    if (!maybacktrack) checksolution= checkunique= 0;
+	    return;
+	}
+
+	setpgid(r[i].pid, r[i].pid);
+	close(fd[1]);
+	r[i].fd= fd[0];
+    }
+
+    /* Collect output from the children until one finishes successfully */
+    for (nleft= nportfolio; nleft > 0; )
+    {
+	for (i= 0; i < nportfolio; i++)
+	{
+	    pfd[i].fd= r[i].pid > 0 ? r[i].fd : -1;
+	    pfd[i].events= POLLIN;
+	}
+	if (poll(pfd, nportfolio, -1) < 0) continue;
+
+	for (i= 0; i < nportfolio; i++)
+	{
+	    if (r[i].pid <= 0 || !pfd[i].revents) continue;
+
+	    if (r[i].nout + 4096 > r[i].sout)
+	    {
+		r[i].sout= r[i].nout + 8192;
+		r[i].out= (char *)realloc(r[i].out, r[i].sout);
+	    }
+	    n= read(r[i].fd, r[i].out + r[i].nout, r[i].sout - r[i].nout);
+	    if (n > 0)
+	    {
+		r[i].nout+= n;
+		continue;
+	    }
+
+	    /* End of output - see how the child did */
+	    close(r[i].fd);
+	    waitpid(r[i].pid, &status, 0);
+	    r[i].pid= 0;
+	    nleft--;
+	    last= i;
+	    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+	    {
+		kill_racers(r, nportfolio);
+		fwrite(r[i].out, 1, r[i].nout, stdout);
+		exit(0);
+	    }
+	}
+    }
+
+    /* Everyone failed - report the last failure */
+    if (last >= 0)
+	fwrite(r[last].out, 1, r[last].nout, stdout);
+    exit(1);
+}
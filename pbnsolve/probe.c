@@ -54,17 +54,48 @@ static long probeseq_res[N_PRBRES][N_PRBSRC]= {{0,0,0},{0,0,0},{0,0,0}};
  * of the previous probe.
  */
 
-bit_type *probepad= NULL;
+Pad *probepad= NULL;
 int probing= 0;
 
+/* BEST PROBE - The cells set by the best probe found so far in the current
+ * probe sequence, and the values they ended up with.  When the sequence is
+ * complete, the chosen guess is made by setting all these again, instead of
+ * running the line solver to rediscover them all.
+ */
+
+static Cell **bestcell= NULL;
+static bit_type *bestbit= NULL;
+static int nbest, sbest= 0;
+static int probeties;		/* How many probes tied for best so far */
+
+#define BESTBIT(i) (bestbit + (i)*fbit_size)
+
+/* PROBE CACHE - For each (cell,color), the rows and columns changed by the
+ * last probe on it that didn't hit a contradiction, and the serial number of
+ * the implication it saved.  If those lines haven't changed since, and we
+ * still have that implication, then probing on it again would just set all
+ * the consequences in the implication and stall, so we do exactly that
+ * without running the line solver.  Only used with implication caching.
+ */
+
+typedef struct {
+    Reach reach;	/* Lines changed by the probe */
+    long serial;	/* imply_serial() of the implication it saved */
+} ProbeMemo;
+
+static ProbeMemo *pmemo= NULL;
+long probereuse= 0;
+
+#define PMEMO(puz,cell,c) pmemo[(cell)->id * (puz)->ncolor + (c)]
+
+
 /* Create or clear the probe pad */
 void init_probepad(Puzzle *puz)
 {
     if (!probepad)
-	probepad= (bit_type *)
-	    calloc(puz->ncells, fbit_size * sizeof(bit_type));
+	probepad= new_pad(puz->ncells, fbit_size * sizeof(bit_type));
     else
-    	memset(probepad, 0, puz->ncells * fbit_size * sizeof(bit_type));
+    	clear_pad(probepad);
 }
 
 
@@ -72,6 +103,17 @@ void init_probepad(Puzzle *puz)
 
 void probe_init(Puzzle *puz, Solution *sol)
 {
+    int i;
+
+    if (pmemo == NULL && mayimply && puz->type == PT_GRID)
+    {
+	pmemo= (ProbeMemo *)malloc(puz->ncells * puz->ncolor *
+		sizeof(ProbeMemo));
+	for (i= puz->ncells * puz->ncolor - 1; i >= 0; i--)
+	    pmemo[i].reach.r1= -1;
+	init_linehash(puz, sol);
+    }
+
     if (probeon[PRBSRC_HEURISTIC])
 	bookkeeping_on(puz,sol);
     else
@@ -79,6 +121,93 @@ void probe_init(Puzzle *puz, Solution *sol)
 }
 
 
+/* SAVE_BEST - The probe we have just completed is the best so far.  The
+ * probe's guess is at history index <base>, so everything after that is a
+ * consequence of it.  Save the cells and their current values.
+ */
+
+static void save_best(Puzzle *puz, int base)
+{
+    int k;
+    Hist *h;
+
+    if (puz->nhist - base > sbest)
+    {
+	sbest= puz->nhist - base + 64;
+	bestcell= (Cell **)realloc(bestcell, sbest * sizeof(Cell *));
+	bestbit= (bit_type *)realloc(bestbit, sbest*fbit_size*sizeof(bit_type));
+    }
+
+    nbest= 0;
+    for (k= base + 1; k < puz->nhist; k++)
+    {
+	h= HIST(puz,k);
+	bestcell[nbest]= HISTCELL(puz,h);
+	fbit_cpy(BESTBIT(nbest), HISTCELL(puz,h)->bit);
+	nbest++;
+    }
+}
+
+
+/* PROBE_GUESS - Make the guess chosen by the last call to probe().  When we
+ * probed on it, the line solver worked out all its consequences and then
+ * stalled, so rather than repeat all that, we just set all the cells to the
+ * values they had at the end of that probe, and leave the job list empty.
+ * The left and right solutions saved for the lines through those cells may
+ * no longer be right, so we discard them.
+ */
+
+void probe_guess(Puzzle *puz, Solution *sol, Cell *cell, color_t c)
+{
+    Hist *h;
+    Cell *cc;
+    dir_t k;
+    int i, changed;
+    color_t z;
+
+    guess_cell(puz, sol, cell, c);
+
+    for (i= 0; i < nbest; i++)
+    {
+	cc= bestcell[i];
+
+	/* Skip cells already set by an earlier entry */
+	changed= 0;
+	for (z= 0; z < fbit_size; z++)
+	    if (cc->bit[z] & ~BESTBIT(i)[z]) changed= 1;
+	if (!changed) continue;
+
+	h= add_hist(puz, cc, 0);
+	for (z= 0; z < fbit_size; z++)
+	    cc->bit[z]&= BESTBIT(i)[z];
+
+	if (puz->ncolor <= 2)
+	    cc->n= 1;
+	else
+	    count_cell(puz,cc);
+
+	if (cc->n == 1) solved_a_cell(puz, cc, 1);
+	trans_cell(puz, cc, h->bit);
+
+	for (k= 0; k < puz->nset; k++)
+	{
+	    puz->clue[k][cc->line[k]].lbadb= -1;
+	    puz->clue[k][cc->line[k]].rbadb= -1;
+	}
+    }
+
+    for (k= 0; k < puz->nset; k++)
+    {
+	puz->clue[k][cell->line[k]].lbadb= -1;
+	puz->clue[k][cell->line[k]].rbadb= -1;
+    }
+    flush_jobs(puz);
+
+    if (VP)
+	printf("P: GUESS SET %d CONSEQUENCES FROM PROBE\n", nbest);
+}
+
+
 /* PROBE_CELL - Do a sequence of probes on a cell.  We normally do one probe
  * on each possible color for the cell.  <cell> points and the cell, and <i>
  * and <j> are its coordinates.  <bestnleft> points to the nleft value of the
@@ -97,13 +226,18 @@ void probe_init(Puzzle *puz, Solution *sol)
 int probe_cell(Puzzle *puz, Solution *sol, Cell *cell, line_t i, line_t j,
 	int *bestnleft, color_t *bestc)
 {
-    color_t c;
-    int rc;
+    color_t c, goalc;
+    int rc, base;
     int nleft;
     int foundbetter= 0;
+    ProbeMemo *m;
 
     merging= mergeprobe;
 
+    /* If we are checking a goal, and still agree with it, then guesses
+     * of the goal color are only taken if there is nothing else */
+    goalc= (goal_directed && offgoal == 0) ? puz->goal[cell->id] : puz->ncolor;
+
     /* For each possible color of the cell */
     for (c= 0; c < puz->ncolor; c++)
     {
@@ -117,37 +251,86 @@ int probe_cell(Puzzle *puz, Solution *sol, Cell *cell, line_t i, line_t j,
 		 */
 		if (merging) merge_cancel();
 	    }
+	    else if (imply_check(puz,sol,cell,c))
+	    {
+		/* Something we learned on an earlier probe tells us that
+		 * this would lead to a contradiction, so we can eliminate
+		 * the color without probing.
+		 */
+		if (merging) merge_cancel();
+		imply_eliminate(puz,sol,cell,c);
+		probing= 0;
+		probeseq_res[PRBRES_CONTRADICT][currsrc]++;
+		return -1;
+	    }
 	    else
 	    {
+		m= (pmemo == NULL) ? NULL : &PMEMO(puz,cell,c);
+		if (m != NULL && m->serial >= 0 &&
+		    (m->serial != imply_serial(puz,cell,c) ||
+		     !reach_same(&m->reach)))
+		    m->serial= -1;
+
 		/* Found a candidate color - go probe on it */
 		if (VP || VB || WC(i,j))
-		    printf("P: PROBING (%d,%d) COLOR %d\n", i,j,c);
-		probes++;
-		probesrc[currsrc]++;
+		    printf("P: %s (%d,%d) COLOR %d\n",
+			(m != NULL && m->serial >= 0) ? "REUSING" : "PROBING",
+			i,j,c);
+		if (m != NULL && m->serial >= 0)
+		    probereuse++;
+		else
+		{
+		    probes++;
+		    probesrc[currsrc]++;
+		}
 
 		if (merging) merge_guess();
 
+		base= puz->nhist;
 		guess_cell(puz,sol,cell,c);
-		rc= logic_solve(puz, sol, 0);
+		imply_apply(puz,sol,cell,c);
+		if (m != NULL && m->serial >= 0)
+		{
+		    /* Nothing it depends on has changed since the last time
+		     * we probed here, so the implication is all there is */
+		    flush_jobs(puz);
+		    rc= 0;
+		}
+		else
+		    rc= logic_solve(puz, sol, 0);
+
+		/* If it stalled in a state we already know is a dead end,
+		 * that's as good as a contradiction */
+		if (rc == 0 && trans_seen(puz)) rc= -1;
 
 		if (rc == 0)
 		{
 		    /* Probe complete - save it's rating and undo it */
 		    nleft= puz->ncells - puz->nsolved;
+		    if (c == goalc) nleft+= puz->ncells;
 		    if (VQ || VP || WC(i,j))
 			printf("P: PROBE #%d ON (%d,%d)%d COMPLETE "
 			    "WITH %d CELLS LEFT (%s)\n",nprobe,
 			    i,j,c,nleft, Probesource[currsrc]);
-		    if (nleft < *bestnleft)
+		    if (nleft < *bestnleft ||
+			(nleft == *bestnleft && random_tie(++probeties)))
 		    {
+			if (nleft < *bestnleft) probeties= 1;
 			*bestnleft= nleft;
 			*bestc= c;
 			foundbetter++;
+			save_best(puz, base);
 		    }
 		    if (VP)
 			printf("P: UNDOING PROBE\n");
 
+		    if (m == NULL)
+			imply_save(puz, sol, cell, c, base);
+		    else if (m->serial < 0 &&
+			    (m->serial= imply_save(puz, sol, cell, c, base)) >= 0)
+			reach_mark(puz, &m->reach, base);
 		    undo(puz, sol, 0);
+		    if (m != NULL && m->serial >= 0) reach_seal(&m->reach);
 		}
 		else if (rc < 0)
 		{
@@ -259,36 +442,185 @@ void add_goodcell(Puzzle *puz, Solution *sol, line_t i, line_t j)
 }
 
 
-/* Search energetically for the guess that lets us make the most progress
- * toward solving the puzzle, by trying lots of guesses and search on each
- * until it stalls.
- *
- * Normally it returns 0, with besti,bestj,bestc containing our favorite guess.
- *
- * If we accidentally solve the puzzle when we were just trying to probe,
- * return 1.
- *
- * If we discover a logically necessary cell, then we set it, add jobs to the
- * job list, and return -1.
+/* FRONTIER - The unsolved cells with two or more solved neighbors, counting
+ * the edge of the grid as solved.  Instead of scanning the whole grid at the
+ * start of every probe sequence, we keep a count of solved neighbors for every
+ * cell.  Keeping it up to date on every change would be too costly, since
+ * most changes are made inside probes and undone again right after, so
+ * solved_a_cell() just notes which cells were touched, and when the next
+ * probe sequence starts we look at just those cells and update the counts of
+ * the ones that really did change.  The frontier is an unordered list, and
+ * frontpos gives each cell's position in it, or -1 if it isn't on it.  It is
+ * only built once we start probing.
  */
 
-int probe(Puzzle *puz, Solution *sol,
-    line_t *besti, line_t *bestj, color_t *bestc)
+static int *frontier= NULL;	/* Ids of the cells in the frontier */
+static int nfront;
+static int *frontpos;		/* Position of each cell in frontier, or -1 */
+static char *nsolnbr;		/* Number of solved neighbors of each cell */
+static char *issolved;		/* Was each cell solved at the last update? */
+static int *touched;		/* Ids of cells touched since the last update */
+static int ntouched;
+static char *istouched;		/* Is each cell in touched[]? */
+
+/* Put the cell on the frontier or take it off, as appropriate */
+static void frontier_check(int id)
+{
+    int in= !issolved[id] && nsolnbr[id] >= 2;
+
+    if (in && frontpos[id] < 0)
+    {
+	frontpos[id]= nfront;
+	frontier[nfront++]= id;
+    }
+    else if (!in && frontpos[id] >= 0)
+    {
+	frontier[frontpos[id]]= frontier[--nfront];
+	frontpos[frontier[nfront]]= frontpos[id];
+	frontpos[id]= -1;
+    }
+}
+
+/* Count the solved neighbors of a cell, edges included */
+static int frontier_count(Puzzle *puz, int id)
+{
+    int ncol= puz->n[D_COL];
+    int i= id / ncol, j= id % ncol;
+
+    return (i == 0 || issolved[id-ncol]) +
+	   (i == puz->n[D_ROW]-1 || issolved[id+ncol]) +
+	   (j == 0 || issolved[id-1]) +
+	   (j == ncol-1 || issolved[id+1]);
+}
+
+static void init_frontier(Puzzle *puz)
+{
+    int id;
+
+    frontier= (int *)malloc(puz->ncells * sizeof(int));
+    frontpos= (int *)malloc(puz->ncells * sizeof(int));
+    nsolnbr= (char *)malloc(puz->ncells);
+    issolved= (char *)malloc(puz->ncells);
+    touched= (int *)malloc(puz->ncells * sizeof(int));
+    istouched= (char *)calloc(puz->ncells, 1);
+    nfront= ntouched= 0;
+
+    for (id= 0; id < puz->ncells; id++)
+    {
+	issolved[id]= (puz->idcell[id]->n == 1);
+	frontpos[id]= -1;
+    }
+    for (id= 0; id < puz->ncells; id++)
+    {
+	nsolnbr[id]= frontier_count(puz, id);
+	frontier_check(id);
+    }
+}
+
+/* FRONTIER_UPDATE - Called from solved_a_cell() whenever a cell is solved
+ * or unsolved.  Just remember that it was touched.
+ */
+
+void frontier_update(Puzzle *puz, Cell *cell, int way)
+{
+    if (frontier == NULL || istouched[cell->id]) return;
+
+    istouched[cell->id]= 1;
+    touched[ntouched++]= cell->id;
+}
+
+/* Bring the frontier up to date with the cells touched since the last time */
+static void frontier_refresh(Puzzle *puz)
+{
+    int a, id, way, ncol= puz->n[D_COL];
+    Cell *cell;
+
+    for (a= 0; a < ntouched; a++)
+    {
+	id= touched[a];
+	istouched[id]= 0;
+	cell= puz->idcell[id];
+	if ((cell->n == 1) == issolved[id]) continue;
+
+	issolved[id]= (cell->n == 1);
+	way= issolved[id] ? 1 : -1;
+	frontier_check(id);
+
+	if (cell->line[D_ROW] > 0)
+	    { nsolnbr[id-ncol]+= way; frontier_check(id-ncol); }
+	if (cell->line[D_ROW] < puz->n[D_ROW]-1)
+	    { nsolnbr[id+ncol]+= way; frontier_check(id+ncol); }
+	if (cell->line[D_COL] > 0)
+	    { nsolnbr[id-1]+= way; frontier_check(id-1); }
+	if (cell->line[D_COL] < ncol-1)
+	    { nsolnbr[id+1]+= way; frontier_check(id+1); }
+    }
+    ntouched= 0;
+}
+
+static int cmp_id(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+
+/* CANDIDATE LIST - The cells we will probe on in the current probe sequence,
+ * in the order we will probe them, and the source of each.  Each cell is
+ * listed only once.
+ */
+
+typedef struct {
+    Cell *cell;
+    line_t i, j;
+    int src;
+} ProbeCand;
+
+static ProbeCand *cand= NULL;
+static int ncand, scand= 0;
+static Pad *candpad= NULL;
+
+/* ADD_CAND - Add a cell to the end of the candidate list, unless it is
+ * already on it, or is in a group we aren't searching.
+ */
+
+static void add_cand(Puzzle *puz, Cell *cell, line_t i, line_t j)
+{
+    char *listed= (char *)pad_elem(candpad, cell->id);
+
+    if (*listed || !in_group(cell)) return;
+    *listed= 1;
+
+    if (ncand >= scand)
+    {
+	scand= ncand + 64;
+	cand= (ProbeCand *)realloc(cand, scand * sizeof(ProbeCand));
+    }
+    cand[ncand].cell= cell;
+    cand[ncand].i= i;
+    cand[ncand].j= j;
+    cand[ncand].src= currsrc;
+    ncand++;
+}
+
+
+/* PROBE_CANDIDATES - Build the list of cells to probe on in this sequence.
+ * When it returns, currsrc is the last source that was scanned.
+ */
+
+static void probe_candidates(Puzzle *puz, Solution *sol)
 {
     line_t i, j, k;
-    int bestsrc;
-    color_t c;
     Cell *cell;
-    int rc, neigh;
-    int bestnleft= INT_MAX;
+    int neigh;
     line_t ci,cj;
     Hist *h;
+    int lastbranch;
 
-    /* Starting a new probe sequence - initialize stuff */
-    if (VP) printf("P: STARTING PROBE SEQUENCE\n");
-    init_probepad(puz);
-    probing= 1;
-    nprobe++;
+    if (candpad == NULL)
+	candpad= new_pad(puz->ncells, 1);
+    else
+	clear_pad(candpad);
+    ncand= 0;
 
     if (probeon[PRBSRC_ADJACENT])
     {
@@ -296,12 +628,13 @@ int probe(Puzzle *puz, Solution *sol,
 	 * since the last guess.
 	 */
 	currsrc= PRBSRC_ADJACENT;
+	lastbranch= LASTBRANCH(puz);
 
 	for (k= puz->nhist - 1; k > 0; k--)
 	{
 	    h= HIST(puz,k);
-	    ci= h->cell->line[D_ROW];
-	    cj= h->cell->line[D_COL];
+	    ci= HISTCELL(puz,h)->line[D_ROW];
+	    cj= HISTCELL(puz,h)->line[D_COL];
 
 	    /* Check the neighbors */
 	    for (neigh= 0; neigh < 4; neigh++)
@@ -323,26 +656,35 @@ int probe(Puzzle *puz, Solution *sol,
 		/* Skip solved cells */
 		if (cell->n < 2) continue;
 
-		/* Test solve with each possible color */
-		rc= probe_cell(puz, sol, cell, i, j, &bestnleft, bestc);
-		if (rc < 0)
-		    return (rc == -2) ? 1 : -1;
-		if (rc > 0)
-		{
-		    *besti= i;
-		    *bestj= j;
-		    bestsrc= currsrc;
-		}
+		add_cand(puz, cell, i, j);
 	    }
 
 	    /* Stop if we reach the cell that was our last guess point */
-	    if (h->branch) break;
+	    if (k == lastbranch) break;
 	}
     }
 
-    /* Scan through all cells, probing on cells with 2 or more solved neighbors
+    /* Probe on cells with 2 or more solved neighbors.  Unless we need to
+     * look at every cell for the heuristic, these come from the frontier,
+     * sorted into the same row by row order a scan would find them in.
      */
-    if (probeon[PRBSRC_TWONEIGH] || probeon[PRBSRC_HEURISTIC])
+    if (probeon[PRBSRC_TWONEIGH] && !probeon[PRBSRC_HEURISTIC])
+    {
+	int a;
+	currsrc= PRBSRC_TWONEIGH;
+	if (frontier == NULL)
+	    init_frontier(puz);
+	else
+	    frontier_refresh(puz);
+	qsort(frontier, nfront, sizeof(int), cmp_id);
+	for (a= 0; a < nfront; a++)
+	{
+	    frontpos[frontier[a]]= a;
+	    cell= puz->idcell[frontier[a]];
+	    add_cand(puz, cell, cell->line[D_ROW], cell->line[D_COL]);
+	}
+    }
+    else if (probeon[PRBSRC_TWONEIGH] || probeon[PRBSRC_HEURISTIC])
     {
 	ngood= 0;
 	currsrc= PRBSRC_TWONEIGH;
@@ -361,16 +703,7 @@ int probe(Puzzle *puz, Solution *sol,
 		    continue;
 		}
 
-		/* Test solve with each possible color */
-		rc= probe_cell(puz, sol, cell, i, j, &bestnleft, bestc);
-		if (rc < 0)
-		    return (rc == -2) ? 1 : -1;
-		if (rc > 0)
-		{
-		    *besti= i;
-		    *bestj= j;
-		    bestsrc= currsrc;
-		}
+		add_cand(puz, cell, i, j);
 	    }
 	}
     }
@@ -381,22 +714,215 @@ int probe(Puzzle *puz, Solution *sol,
 	int a;
 	currsrc= PRBSRC_HEURISTIC;
 	for (a= 0; a < ngood; a++)
+	    add_cand(puz, sol->line[D_ROW][goodcell[a].i][goodcell[a].j],
+		goodcell[a].i, goodcell[a].j);
+    }
+
+    /* If none of those were in the group we are searching, try all of it */
+    if (ncand == 0 && curlev >= 0)
+    {
+	int id;
+	for (id= 0; id < puz->ncells; id++)
 	{
-	    /* Test solve with each possible color */
-	    cell= sol->line[D_ROW][goodcell[a].i][goodcell[a].j];
-	    rc= probe_cell(puz, sol, cell, goodcell[a].i, goodcell[a].j,
+	    cell= puz->idcell[id];
+	    if (cell->n > 1)
+		add_cand(puz, cell, cell->line[D_ROW], cell->line[D_COL]);
+	}
+    }
+}
+
+
+/* PROBE_WORKER - In a worker process, claim probe candidates from the shared
+ * task list and probe on them, until we run out or find something that ends
+ * the probe sequence.  Leave the best guess found in our result slot.
+ */
+
+void probe_worker(Puzzle *puz, Solution *sol, WorkSlot *slot)
+{
+    int a, i, rc;
+    int bestnleft= INT_MAX;
+    long oldsrc[N_PRBSRC], oldlines;
+    color_t c;
+    Cell *cell;
+
+    init_probepad(puz);
+    probing= 1;
+    for (i= 0; i < N_PRBSRC; i++)
+	oldsrc[i]= probesrc[i];
+    oldlines= nlines;
+
+    while ((a= claim_task()) >= 0)
+    {
+	cell= puz->idcell[worktask[a] / N_PRBSRC];
+	currsrc= worktask[a] % N_PRBSRC;
+
+	rc= probe_cell(puz, sol, cell, cell->line[D_ROW], cell->line[D_COL],
+		&bestnleft, &c);
+	if (rc < 0)
+	{
+	    stop_task(a);
+	    break;
+	}
+	if (rc > 0)
+	{
+	    slot->best= a;
+	    slot->bestc= c;
+	    slot->bestval= bestnleft;
+	    slot->nset= nbest;
+	    for (i= 0; i < nbest; i++)
+	    {
+		slot->cellid[i]= bestcell[i]->id;
+		fbit_cpy((slot->cellbit + i*fbit_size), BESTBIT(i));
+	    }
+	}
+    }
+    probing= 0;
+
+    for (i= 0; i < N_PRBSRC; i++)
+	slot->count[i]= probesrc[i] - oldsrc[i];
+    slot->count[N_PRBSRC]= nlines - oldlines;
+}
+
+
+/* PROBE_PARALLEL - Probe on all the candidates using the worker processes.
+ * If some probe found a contradiction, solved the puzzle or gave a merge,
+ * we redo the probes on the earliest such candidate here, so that it takes
+ * effect in our grid.
+ * Otherwise we adopt the best guess, preferring the earliest candidate
+ * among equally good ones, again just like serial probing.  Return codes
+ * are as for probe(), and <bestnleft> is set as for probe_cell().
+ */
+
+static int probe_parallel(Puzzle *puz, Solution *sol, int *bestnleft,
+    line_t *besti, line_t *bestj, color_t *bestc, int *bestsrc)
+{
+    int a, w, rc;
+    WorkSlot *win= NULL;
+
+    init_workers(puz, sol);
+    for (a= 0; a < ncand; a++)
+	worktask[a]= cand[a].cell->id * N_PRBSRC + cand[a].src;
+
+    run_workers(puz, sol, WCMD_PROBE, ncand);
+
+    for (w= 0; w < nworkers; w++)
+    {
+	for (a= 0; a < N_PRBSRC; a++)
+	{
+	    probesrc[a]+= workslot[w].count[a];
+	    probes+= workslot[w].count[a];
+	}
+	nlines+= workslot[w].count[N_PRBSRC];
+	if (workslot[w].best >= 0 && (win == NULL ||
+	     workslot[w].bestval < win->bestval ||
+	     (workslot[w].bestval == win->bestval &&
+	      workslot[w].best < win->best)))
+	    win= &workslot[w];
+    }
+
+    if ((a= workhead->stop) < ncand)
+    {
+	currsrc= cand[a].src;
+	rc= probe_cell(puz, sol, cand[a].cell, cand[a].i, cand[a].j,
+		bestnleft, bestc);
+	if (rc < 0)
+	    return (rc == -2) ? 1 : -1;
+
+	/* Our line solver state can differ slightly from the worker's, so
+	 * it is possible that we don't find what it found.  Then just use
+	 * the best guess we have. */
+	if (rc > 0)
+	{
+	    *besti= cand[a].i;
+	    *bestj= cand[a].j;
+	    *bestsrc= cand[a].src;
+	}
+	if (win != NULL && win->bestval >= *bestnleft)
+	    win= NULL;
+    }
+
+    if (win != NULL)
+    {
+	a= win->best;
+	*besti= cand[a].i;
+	*bestj= cand[a].j;
+	*bestc= win->bestc;
+	*bestsrc= cand[a].src;
+	*bestnleft= win->bestval;
+
+	if (win->nset > sbest)
+	{
+	    sbest= win->nset + 64;
+	    bestcell= (Cell **)realloc(bestcell, sbest * sizeof(Cell *));
+	    bestbit= (bit_type *)realloc(bestbit, sbest*fbit_size*sizeof(bit_type));
+	}
+	nbest= win->nset;
+	for (w= 0; w < nbest; w++)
+	{
+	    bestcell[w]= puz->idcell[win->cellid[w]];
+	    fbit_cpy(BESTBIT(w), (win->cellbit + w*fbit_size));
+	}
+    }
+    return 0;
+}
+
+
+/* Search energetically for the guess that lets us make the most progress
+ * toward solving the puzzle, by trying lots of guesses and search on each
+ * until it stalls.
+ *
+ * Normally it returns 0, with besti,bestj,bestc containing our favorite guess.
+ *
+ * If we accidentally solve the puzzle when we were just trying to probe,
+ * return 1.
+ *
+ * If we discover a logically necessary cell, then we set it, add jobs to the
+ * job list, and return -1.
+ */
+
+int probe(Puzzle *puz, Solution *sol,
+    line_t *besti, line_t *bestj, color_t *bestc)
+{
+    int a, rc, seqsrc;
+    int bestsrc;
+    int bestnleft= INT_MAX;
+
+    /* Starting a new probe sequence - initialize stuff */
+    if (VP) printf("P: STARTING PROBE SEQUENCE\n");
+    init_probepad(puz);
+    probeties= 0;
+    probing= 1;
+    nprobe++;
+
+    probe_candidates(puz, sol);
+    seqsrc= currsrc;
+
+    if (nworkers > 0 && !isworker && ncand > 1)
+    {
+	/* Farm the probes out to the worker processes */
+	rc= probe_parallel(puz, sol, &bestnleft, besti, bestj, bestc, &bestsrc);
+	if (rc != 0) return rc;
+    }
+    else
+    {
+	/* Test solve each candidate with each possible color */
+	for (a= 0; a < ncand; a++)
+	{
+	    currsrc= cand[a].src;
+	    rc= probe_cell(puz, sol, cand[a].cell, cand[a].i, cand[a].j,
 		    &bestnleft, bestc);
 	    if (rc < 0)
 		return (rc == -2) ? 1 : -1;
 	    if (rc > 0)
 	    {
-		*besti= goodcell[a].i;
-		*bestj= goodcell[a].j;
+		*besti= cand[a].i;
+		*bestj= cand[a].j;
 		bestsrc= currsrc;
 	    }
 	}
     }
 
+    currsrc= seqsrc;
     probeseq_res[PRBRES_BEST][currsrc]++;
 
     /* completed probing all cells - select best as our guess */
@@ -455,26 +981,8 @@ void probe_stats(void)
 	comma= 1;
     }
     printf(")\n");
-}
-
-
-/* Return the fraction of probe sequences that have have ended in making
- * a guess (ie, have not found a contradiction or a solution).
- */
-float probe_rate(void)
-{
-    int i,n;
-    float rate;
-    static long lastn= 0;
-    static long lastnprobe= 0;
-
-    for (i= 0; i < N_PRBSRC; i++)
-	n+= probeseq_res[PRBRES_BEST][i];
-
-    rate= (float)(n-lastn)/(float)(nprobe-lastnprobe);
-    lastn= n;
-    lastnprobe= nprobe;
-    return rate;
+    if (pmemo != NULL)
+	printf("Reused probes: %ld\n",probereuse);
 }
 
 
@@ -0,0 +1,687 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Distributed Search
+ *
+ * For very hard puzzles, the search can be spread over several machines.
+ * One copy of pbnsolve is started as the coordinator with -D<addr>, and any
+ * number of others as workers with -W<addr>, all on the same puzzle.  The
+ * <addr> is either the path of a Unix socket, or host:port for TCP.  The
+ * coordinator can give just :port to listen on all interfaces.
+ *
+ * The coordinator line solves as far as it can, and then hands out pieces of
+ * the search tree as guess paths.  A path is a list of cells and the colors
+ * each is to be limited to, applied in order to the stalled grid.  Every
+ * process can get to the stalled grid on its own, so only the path needs to
+ * be sent.  At first the only piece is the empty path, which is the whole
+ * search.  When a worker is idle and there are no pieces left, the
+ * coordinator asks a busy worker for more, and it gives away the untried
+ * alternative of its oldest guess, as in -aS.
+ *
+ * The protocol is lines of text.  From the workers:
+ *
+ *    HELLO <sum>	First message.  <sum> is a checksum of the clues.
+ *    FOUND <grid>	A solution, with one color character per cell.
+ *    SPLIT <path>	Part of our search, for someone else to do.
+ *    DONE		We have finished the search we were given.
+ *
+ * From the coordinator:
+ *
+ *    TASK <path>	Search this.
+ *    MORE		Give away part of your search as soon as you can.
+ *
+ * A path is a list of <id>:<bits> items separated by spaces, where <id> is a
+ * cell id and <bits> the colors it may be, as a comma separated list of hex
+ * words.  When the search is over, the coordinator closes its connections
+ * and the workers exit.  If a worker goes away in the middle of a search,
+ * its task is given to someone else.
+ */
+
+#include "pbnsolve.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+
+char *coordaddr= NULL;		/* Address to coordinate a search on */
+char *workaddr= NULL;		/* Address of coordinator to work for */
+int remoting= 0;		/* True in a worker doing a search */
+
+typedef struct {
+    int fd;
+    char *buf;			/* Input read but not yet used */
+    int nbuf, sbuf;
+    int hello;			/* Has it said hello? */
+    char *task;			/* Path it is searching, NULL if idle */
+    int asked;			/* Have we asked it for more work? */
+} Peer;
+
+static Peer me;			/* In a worker, our connection */
+static char *mytask;		/* In a worker, the path we are searching */
+static int wantmore;		/* In a worker, has more work been asked for? */
+
+
+/* PUZZLE_SUM - A checksum of the puzzle's clues, so workers working on some
+ * other puzzle can be turned away.
+ */
+
+static unsigned long puzzle_sum(Puzzle *puz)
+{
+    unsigned long sum= puz->ncolor;
+    dir_t k;
+    line_t i, j;
+    Clue *clue;
+
+    for (k= 0; k < puz->nset; k++)
+	for (i= 0; i < puz->n[k]; i++)
+	{
+	    clue= &puz->clue[k][i];
+	    sum= sum * 31 + clue->n;
+	    for (j= 0; j < clue->n; j++)
+		sum= (sum * 31 + clue->length[j]) * 31 + clue->color[j];
+	}
+    return sum;
+}
+
+
+/* OPEN_SOCKET - Open a socket for the given address.  If <listening> is
+ * true, set it up to accept connections.  Otherwise connect to it, trying
+ * for up to REMOTE_WAIT seconds in case the coordinator isn't up yet.
+ */
+
+static int open_socket(char *addr, int listening)
+{
+    struct sockaddr_un sun;
+    struct addrinfo hints, *ai, *a;
+    char *host, *port;
+    time_t start= time(NULL);
+    int fd, on= 1;
+
+    if (strchr(addr, '/') != NULL)
+    {
+	/* Unix domain socket */
+	if (strlen(addr) >= sizeof(sun.sun_path))
+	    fail("Socket path too long: %s\n", addr);
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family= AF_UNIX;
+	strcpy(sun.sun_path, addr);
+
+	if ((fd= socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+	    fail("Could not create socket\n");
+	if (listening)
+	{
+	    unlink(addr);
+	    if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) ||
+		    listen(fd, 16))
+		fail("Could not listen on %s\n", addr);
+	    return fd;
+	}
+	while (connect(fd, (struct sockaddr *)&sun, sizeof(sun)))
+	{
+	    if (time(NULL) - start > REMOTE_WAIT)
+		fail("Could not connect to %s\n", addr);
+	    sleep(1);
+	}
+	return fd;
+    }
+
+    /* TCP socket */
+    if ((port= strrchr(addr, ':')) == NULL)
+	fail("Address should be host:port or a socket path: %s\n", addr);
+    host= strdup(addr);
+    host[port - addr]= '\0';
+    port++;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family= AF_UNSPEC;
+    hints.ai_socktype= SOCK_STREAM;
+    if (listening) hints.ai_flags= AI_PASSIVE;
+
+    for (;;)
+    {
+	if (getaddrinfo(host[0] == '\0' ? NULL : host, port, &hints, &ai))
+	    fail("Could not look up %s\n", addr);
+	for (a= ai; a != NULL; a= a->ai_next)
+	{
+	    if ((fd= socket(a->ai_family, a->ai_socktype, a->ai_protocol)) < 0)
+		continue;
+	    if (listening)
+	    {
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (!bind(fd, a->ai_addr, a->ai_addrlen) && !listen(fd, 16))
+		    break;
+	    }
+	    else if (!connect(fd, a->ai_addr, a->ai_addrlen))
+		break;
+	    close(fd);
+	}
+	freeaddrinfo(ai);
+	if (a != NULL) break;
+
+	if (listening)
+	    fail("Could not listen on %s\n", addr);
+	if (time(NULL) - start > REMOTE_WAIT)
+	    fail("Could not connect to %s\n", addr);
+	sleep(1);
+    }
+    free(host);
+    return fd;
+}
+
+
+/* SEND_LINE - Send a line, made of the two given strings, to a peer.  The
+ * second may be NULL.  Returns 0 if the connection is broken.
+ */
+
+static int send_line(Peer *p, char *s1, char *s2)
+{
+    char *part[3], *s;
+    int i, n, len;
+
+    part[0]= s1;
+    part[1]= (s2 == NULL) ? "" : s2;
+    part[2]= "\n";
+
+    for (i= 0; i < 3; i++)
+	for (s= part[i], len= strlen(s); len > 0; s+= n, len-= n)
+	    if ((n= write(p->fd, s, len)) <= 0)
+		return 0;
+    return 1;
+}
+
+
+/* PEER_READ - Read whatever is available from a peer into its buffer.
+ * Returns 0 if the connection has been closed.
+ */
+
+static int peer_read(Peer *p)
+{
+    int n;
+
+    if (p->nbuf + 4096 > p->sbuf)
+    {
+	p->sbuf= p->nbuf + 8192;
+	p->buf= (char *)realloc(p->buf, p->sbuf);
+    }
+    n= read(p->fd, p->buf + p->nbuf, p->sbuf - p->nbuf - 1);
+    if (n <= 0) return 0;
+    p->nbuf+= n;
+    return 1;
+}
+
+
+/* NEXT_LINE - Take the next complete line from a peer's buffer, and return
+ * it in malloced memory without the newline.  Returns NULL if there is none.
+ */
+
+static char *next_line(Peer *p)
+{
+    char *nl, *line;
+    int n;
+
+    if (p->nbuf == 0) return NULL;
+    p->buf[p->nbuf]= '\0';
+    if ((nl= strchr(p->buf, '\n')) == NULL) return NULL;
+
+    n= nl - p->buf;
+    line= (char *)malloc(n + 1);
+    memcpy(line, p->buf, n);
+    line[n]= '\0';
+
+    p->nbuf-= n + 1;
+    memmove(p->buf, nl + 1, p->nbuf);
+    return line;
+}
+
+
+/* PATH_TEXT - Return, in malloced memory, the path <base> extended by the
+ * <n> cells in <id>, limited to the colors in <bit>.
+ */
+
+static char *path_text(char *base, int n, int *id, bit_type *bit)
+{
+    char *s= (char *)malloc(strlen(base) + n * (12 + 17 * fbit_size) + 1);
+    char *p= s;
+    int i;
+    color_t z;
+
+    p+= sprintf(p, "%s", base);
+    for (i= 0; i < n; i++)
+    {
+	p+= sprintf(p, "%s%d:", p == s ? "" : " ", id[i]);
+	for (z= 0; z < fbit_size; z++)
+	    p+= sprintf(p, "%s%lx", z ? "," : "", bit[i*fbit_size + z]);
+    }
+    return s;
+}
+
+
+/* APPLY_PATH - Limit the cells on the path to the colors given there, and
+ * put the lines through them on the job list.  Returns 0 if that leaves some
+ * cell with no colors, or if the path is garbled.
+ */
+
+static int apply_path(Puzzle *puz, Solution *sol, char *path)
+{
+    static bit_type *old= NULL, *new= NULL;
+    Cell *cell;
+    char *p= path;
+    int id, any, same;
+    color_t z;
+
+    if (old == NULL)
+    {
+	old= (bit_type *)malloc(fbit_size * sizeof(bit_type));
+	new= (bit_type *)malloc(fbit_size * sizeof(bit_type));
+    }
+
+    while (*p != '\0')
+    {
+	id= strtol(p, &p, 10);
+	if (*p++ != ':' || id < 0 || id >= puz->ncells) return 0;
+	cell= puz->idcell[id];
+
+	any= 0; same= 1;
+	for (z= 0; z < fbit_size; z++)
+	{
+	    new[z]= strtoul(p, &p, 16) & cell->bit[z];
+	    if (new[z] != 0) any= 1;
+	    if (new[z] != cell->bit[z]) same= 0;
+	    if (z < fbit_size - 1 && *p++ != ',') return 0;
+	}
+	while (*p == ' ') p++;
+
+	if (!any) return 0;
+	if (same) continue;
+
+	if (cell->n == 1) solved_a_cell(puz, cell, -1);
+	fbit_cpy(old, cell->bit);
+	fbit_cpy(cell->bit, new);
+	count_cell(puz, cell);
+	if (cell->n == 1) solved_a_cell(puz, cell, 1);
+	trans_cell(puz, cell, old);
+	add_jobs(puz, sol, -1, cell, 0, old);
+    }
+    return 1;
+}
+
+
+/* GRID_TEXT - Return, in malloced memory, the grid as a string with one color
+ * character for each cell, in id order.
+ */
+
+static char *grid_text(Puzzle *puz)
+{
+    char *s= (char *)malloc(puz->ncells + 1);
+    int id;
+    color_t c;
+
+    for (id= 0; id < puz->ncells; id++)
+    {
+	s[id]= '?';
+	for (c= 0; c < puz->ncolor; c++)
+	    if (may_be(puz->idcell[id], c))
+	    {
+		s[id]= puz->color[c].ch;
+		break;
+	    }
+    }
+    s[id]= '\0';
+    return s;
+}
+
+
+/* LOAD_TEXT - In the coordinator, set our grid to a solution sent by a
+ * worker, and return the usual string version of it.
+ */
+
+static char *load_text(Puzzle *puz, Solution *sol, char *text)
+{
+    bit_type *grid= (bit_type *)calloc(puz->ncells * fbit_size,
+	sizeof(bit_type));
+    int id;
+    color_t c;
+
+    for (id= 0; id < puz->ncells; id++)
+	for (c= 0; c < puz->ncolor; c++)
+	    if (puz->color[c].ch == text[id])
+		bit_set((grid + id*fbit_size), c);
+    load_grid(puz, sol, grid);
+    free(grid);
+    return solution_string(puz, sol);
+}
+
+
+/* REMOTE_POLL - Called by solve() in a worker each time around the search
+ * loop.  If the coordinator has asked for more work, give it some, if we
+ * have any.  If the coordinator has gone away, the search is over.
+ */
+
+void remote_poll(Puzzle *puz, Solution *sol)
+{
+    static int *id= NULL, sid= 0;
+    static bit_type *bit= NULL;
+    struct pollfd pfd;
+    char *line, *path;
+    int n;
+
+    pfd.fd= me.fd;
+    pfd.events= POLLIN;
+    if (poll(&pfd, 1, 0) > 0)
+    {
+	if (!peer_read(&me)) exit(0);
+	while ((line= next_line(&me)) != NULL)
+	{
+	    if (!strcmp(line, "MORE")) wantmore= 1;
+	    free(line);
+	}
+    }
+
+    if (!wantmore || puz->nbranch == 0) return;
+
+    if (puz->nhist > sid)
+    {
+	sid= puz->nhist + 64;
+	id= (int *)realloc(id, sid * sizeof(int));
+	bit= (bit_type *)realloc(bit, sid * fbit_size * sizeof(bit_type));
+    }
+    if ((n= split_path(puz, sol, id, bit)) < 0) return;
+
+    path= path_text(mytask, n, id, bit);
+    if (!send_line(&me, "SPLIT ", path)) exit(0);
+    free(path);
+    wantmore= 0;
+    splits++;
+}
+
+
+/* REMOTE_WORKER - Connect to the coordinator and search the pieces of the
+ * search tree it gives us until it closes the connection.  Never returns.
+ */
+
+void remote_worker(Puzzle *puz, Solution *sol)
+{
+    bit_type *root;
+    char *line, *s, sum[32];
+    int id;
+
+    signal(SIGPIPE, SIG_IGN);
+    memset(&me, 0, sizeof(me));
+    me.fd= open_socket(workaddr, 0);
+
+    sprintf(sum, "%lu", puzzle_sum(puz));
+    if (!send_line(&me, "HELLO ", sum)) exit(0);
+
+    /* Every path starts from the grid we get to by line solving */
+    logic_solve(puz, sol, 0);
+    root= (bit_type *)malloc(puz->ncells * fbit_size * sizeof(bit_type));
+    for (id= 0; id < puz->ncells; id++)
+	fbit_cpy((root + id*fbit_size), puz->idcell[id]->bit);
+
+    for (;;)
+    {
+	while ((line= next_line(&me)) == NULL)
+	    if (!peer_read(&me)) exit(0);
+
+	if (strncmp(line, "TASK", 4))
+	{
+	    /* Some leftover request for more work */
+	    free(line);
+	    continue;
+	}
+
+	mytask= line + 4 + (line[4] == ' ');
+	wantmore= 0;
+	load_grid(puz, sol, root);
+	if (apply_path(puz, sol, mytask))
+	{
+	    /* Search, backtracking after each solution to find more */
+	    remoting= 1;
+	    while (solve(puz, sol))
+	    {
+		if (puz->nsolved == puz->ncells)
+		{
+		    s= grid_text(puz);
+		    if (!send_line(&me, "FOUND ", s)) exit(0);
+		    free(s);
+		}
+		if (backtrack(puz, sol)) break;
+	    }
+	    remoting= 0;
+	}
+	free(line);
+	if (!send_line(&me, "DONE", NULL)) exit(0);
+    }
+}
+
+
+/* DROP_PEER - Close a connection to a worker.  If it was in the middle of a
+ * search, put its task back in the pool for someone else.
+ */
+
+static void drop_peer(Peer *p, char ***pool, int *npool, int *spool)
+{
+    if (p->task != NULL)
+    {
+	if (*npool >= *spool)
+	{
+	    *spool= 2 * *spool + 8;
+	    *pool= (char **)realloc(*pool, *spool * sizeof(char *));
+	}
+	(*pool)[(*npool)++]= p->task;
+	p->task= NULL;
+    }
+    close(p->fd);
+    p->fd= -1;
+    free(p->buf);
+    p->buf= NULL;
+}
+
+
+/* REMOTE_SOLVE - Solve the puzzle, handing the search out to workers that
+ * connect to us if we need to search.  This is called instead of solve(),
+ * and leaves things the same way split_solve() does.
+ */
+
+int remote_solve(Puzzle *puz, Solution *sol, char *goal, int *guessed)
+{
+    Peer *peer= NULL, *p;
+    struct pollfd *pfd= NULL;
+    char **pool, *line, *found[2], *s, sum[32];
+    int lfd, fd, npeer= 0, speer= 0, npool, spool= 8;
+    int nfound= 0, maxfound, nbusy= 0, nidle, nasked, i, rc;
+
+    *guessed= 0;
+    rc= logic_solve(puz, sol, 0);
+    if (rc != 0) return rc > 0;
+
+    signal(SIGPIPE, SIG_IGN);
+    lfd= open_socket(coordaddr, 1);
+    sprintf(sum, "%lu", puzzle_sum(puz));
+    maxfound= checkunique ? 2 : 1;
+
+    /* To start with, the only task is the whole search */
+    pool= (char **)malloc(spool * sizeof(char *));
+    pool[0]= strdup("");
+    npool= 1;
+
+    while (npool > 0 || nbusy > 0)
+    {
+	/* Hand out tasks to idle workers */
+	nidle= nasked= 0;
+	for (i= 0; i < npeer; i++)
+	{
+	    p= &peer[i];
+	    if (p->fd < 0 || !p->hello || p->task != NULL) continue;
+	    if (npool == 0)
+		nidle++;
+	    else
+	    {
+		p->task= pool[--npool];
+		p->asked= 0;
+		nbusy++;
+		if (!send_line(p, "TASK ", p->task))
+		{
+		    nbusy--;
+		    drop_peer(p, &pool, &npool, &spool);
+		}
+	    }
+	}
+
+	/* Ask busy workers for more, one for each idle one */
+	for (i= 0; i < npeer; i++)
+	    if (peer[i].fd >= 0 && peer[i].asked) nasked++;
+	for (i= 0; i < npeer && nasked < nidle; i++)
+	{
+	    p= &peer[i];
+	    if (p->fd < 0 || p->task == NULL || p->asked) continue;
+	    if (send_line(p, "MORE", NULL))
+		p->asked= 1, nasked++;
+	}
+
+	/* Wait for something to happen */
+	pfd= (struct pollfd *)realloc(pfd, (npeer + 1) * sizeof(struct pollfd));
+	pfd[0].fd= lfd;
+	pfd[0].events= POLLIN;
+	for (i= 0; i < npeer; i++)
+	{
+	    pfd[i+1].fd= peer[i].fd;
+	    pfd[i+1].events= POLLIN;
+	}
+	if (poll(pfd, npeer + 1, -1) <= 0) continue;
+
+	for (i= 0; i < npeer; i++)
+	{
+	    p= &peer[i];
+	    if (p->fd < 0 || !pfd[i+1].revents) continue;
+
+	    if (!peer_read(p))
+	    {
+		if (p->task != NULL) nbusy--;
+		drop_peer(p, &pool, &npool, &spool);
+		continue;
+	    }
+
+	    while (p->fd >= 0 && (line= next_line(p)) != NULL)
+	    {
+		if (!strncmp(line, "HELLO ", 6))
+		{
+		    if (strcmp(line + 6, sum))
+		    {
+			fprintf(stderr,"Turned away worker for another puzzle\n");
+			drop_peer(p, &pool, &npool, &spool);
+		    }
+		    else
+			p->hello= 1;
+		}
+		else if (!strncmp(line, "FOUND ", 6) &&
+			strlen(line + 6) == puz->ncells)
+		{
+		    /* Workers that were lost may have found it already */
+		    if (nfound == 0 || (nfound == 1 && strcmp(found[0], line+6)))
+		    {
+			found[nfound++]= strdup(line + 6);
+			if (nfound >= maxfound)
+			{
+			    free(line);
+			    goto done;
+			}
+		    }
+		}
+		else if (!strncmp(line, "SPLIT ", 6))
+		{
+		    if (npool >= spool)
+		    {
+			spool*= 2;
+			pool= (char **)realloc(pool, spool * sizeof(char *));
+		    }
+		    pool[npool++]= strdup(line + 6);
+		    p->asked= 0;
+		    splits++;
+		}
+		else if (!strcmp(line, "DONE") && p->task != NULL)
+		{
+		    free(p->task);
+		    p->task= NULL;
+		    p->asked= 0;
+		    nbusy--;
+		}
+		free(line);
+	    }
+	}
+
+	/* Accept new workers */
+	if (pfd[0].revents && (fd= accept(lfd, NULL, NULL)) >= 0)
+	{
+	    for (i= 0; i < npeer && peer[i].fd >= 0; i++)
+		;
+	    if (i == npeer)
+	    {
+		if (npeer >= speer)
+		{
+		    speer= 2 * speer + 8;
+		    peer= (Peer *)realloc(peer, speer * sizeof(Peer));
+		}
+		npeer++;
+	    }
+	    memset(&peer[i], 0, sizeof(Peer));
+	    peer[i].fd= fd;
+	}
+    }
+
+done:
+    /* Closing the connections tells the workers we are done */
+    for (i= 0; i < npeer; i++)
+	if (peer[i].fd >= 0) close(peer[i].fd);
+    close(lfd);
+    if (strchr(coordaddr, '/') != NULL) unlink(coordaddr);
+
+    *guessed= 1;
+    if (nfound == 0) return 0;
+
+    /* A solution that isn't the goal settles things */
+    if (goal != NULL)
+	for (i= 0; i < nfound; i++)
+	{
+	    s= load_text(puz, sol, found[i]);
+	    if (strcmp(s, goal))
+	    {
+		puz->found= s;
+		return 1;
+	    }
+	    free(s);
+	}
+
+    if (nfound == 1)
+    {
+	s= load_text(puz, sol, found[0]);
+	if (!checkunique)
+	{
+	    free(s);
+	    return 1;
+	}
+	/* Unique - report it the way a failed search for a second one does */
+	puz->found= s;
+	return 0;
+    }
+
+    puz->found= load_text(puz, sol, found[1]);
+    free(load_text(puz, sol, found[0]));
+    return 1;
+}
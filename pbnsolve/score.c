@@ -30,6 +30,21 @@ int count_colors= 0;	/* Should we count colors in each line? */
 int score_adjust= 0;	/* Subtraction from line score when cell is solved */
 int bookkeeping= 0;	/* Is bookkeeping for the above currently on? */
 int need_goal_array= 0;	/* Do we need the goal array? */
+int randomize= 0;	/* Break ties between equal choices randomly? */
+int goal_directed= 0;	/* Guess away from the goal while we agree with it? */
+long offgoal= 0;	/* Number of solved cells not of the goal color */
+
+
+/* RANDOM_TIE - Called when a candidate turns up that is exactly as good as
+ * the best so far, and is the n-th such, counting the first.  Returns true
+ * if it should replace the best.  This gives all the tied candidates an
+ * equal chance of winning.  Without randomizing, the first one always wins.
+ */
+
+int random_tie(int n)
+{
+    return randomize && rand() % n == 0;
+}
 
 
 /* ----------------- LINE SCORE INITIALIZATION FUNCTIONS ----------------- */
@@ -190,6 +205,22 @@ float cell_score_neighbor(Puzzle *puz, Solution *sol, line_t i, line_t j)
 }
 
 
+/* CELL_SCORE_PROB - Score is one minus the estimated probability of the
+ * cell's most likely color, from counting the solutions to its row and
+ * column.  We want the cell we are surest of.
+ */
+
+float cell_score_prob(Puzzle *puz, Solution *sol, line_t i, line_t j)
+{
+    float *p= cell_prob(puz, sol, sol->line[0][i][j]), best= 0.0;
+    color_t c;
+
+    for (c= 0; c < puz->ncolor; c++)
+	if (p[c] > best) best= p[c];
+    return 1.0 - best;
+}
+
+
 /* These point to the cell_score functions currently being used.  The
  * second one can be NULL.  If there are two, the second is used to break
  * ties in the first
@@ -256,6 +287,7 @@ color_t pick_color_rand(Puzzle *puz, Solution *sol, Cell *cell)
 color_t pick_color_contrast(Puzzle *puz, Solution *sol, Cell *cell)
 {
     color_t c, bestc, n, bestn= -1;
+    int nties= 0;
     line_t i= cell->line[0];
     line_t j= cell->line[1];
 
@@ -291,7 +323,10 @@ color_t pick_color_contrast(Puzzle *puz, Solution *sol, Cell *cell)
 	    {
 		bestc= c;
 	     	bestn= n;
+		nties= 1;
 	    }
+	    else if (n == bestn && random_tie(++nties))
+		bestc= c;
 	}
     return bestc;
 }
@@ -310,7 +345,7 @@ color_t pick_color_prob(Puzzle *puz, Solution *sol, Cell *cell)
 {
     color_t c, bestc;
     line_t n, bestn= -9999;
-    int k;
+    int k, nties= 0;
 
     for(c= 0; c < puz->ncolor; c++)
 	if (may_be(cell,c))
@@ -326,7 +361,35 @@ color_t pick_color_prob(Puzzle *puz, Solution *sol, Cell *cell)
 	    {
 		bestn= n;
 		bestc= c;
+		nties= 1;
+	    }
+	    else if (n == bestn && random_tie(++nties))
+		bestc= c;
+	}
+    return bestc;
+}
+
+/* PICK_COLOR_LINEPROB - Pick the most likely color for this cell, based on
+ * counting the solutions to its row and column.
+ */
+
+color_t pick_color_lineprob(Puzzle *puz, Solution *sol, Cell *cell)
+{
+    float *p= cell_prob(puz, sol, cell), bestp= -1.0;
+    color_t c, bestc= 0;
+    int nties= 0;
+
+    for (c= 0; c < puz->ncolor; c++)
+	if (may_be(cell,c))
+	{
+	    if (p[c] > bestp)
+	    {
+		bestp= p[c];
+		bestc= c;
+		nties= 1;
 	    }
+	    else if (p[c] == bestp && random_tie(++nties))
+		bestc= c;
 	}
     return bestc;
 }
@@ -376,12 +439,47 @@ color_t pick_color_wrong(Puzzle *puz, Solution *sol, Cell *cell)
 }
 
 
+/* GOAL_DIRECT - Set up to check the uniqueness of a goal solution.  Any
+ * other solution has to differ from the goal somewhere, so as long as
+ * everything we have set agrees with the goal, we guess colors other than
+ * the goal's, by pick_color_wrong() or by preferring such probes.  If that
+ * fails, we learn that the cell must be the goal color.  Once we are off the
+ * goal, any solution will do, so we go back to the usual heuristics.  To know
+ * when that is, solved_a_cell() counts the solved cells that are off goal.
+ */
+
+void goal_direct(void)
+{
+    goal_directed= 1;
+    need_goal_array= 1;
+    if (pick_color_fallback == NULL)
+	pick_color_fallback= pick_color;
+}
+
+
+/* PICK_GUESS_COLOR - Pick a color to guess for a cell chosen by heuristic
+ * search.
+ */
+
+color_t pick_guess_color(Puzzle *puz, Solution *sol, Cell *cell)
+{
+    if (goal_directed && offgoal == 0)
+	return pick_color_wrong(puz, sol, cell);
+    return (*pick_color)(puz, sol, cell);
+}
+
+
 /* This points to the pick_color function currently being used */
 
 color_t (*pick_color)(Puzzle *puz, Solution *sol, Cell *cell);
 
 /* ---------------------------------------------------------------- */
 
+/* The cell index used by pick_a_cell(), defined below */
+static int nleaf;
+static void dirty_line(int l);
+
+
 /* BOOKKEEPING_ON - Start continuously updating the color count and score
  * arrays in the Clue data structure.  
  */
@@ -399,6 +497,11 @@ void bookkeeping_on(Puzzle *puz, Solution *sol)
     if (bookkeeping) return;
     bookkeeping= 1;
 
+    /* Line scores are all about to be recomputed */
+    if (nleaf > 0)
+	for (i= 0; i < puz->n[0] + puz->n[1]; i++)
+	    dirty_line(i);
+
     for (k= 0; k < puz->nset; k++)
     {
 	for (i= 0; i < puz->n[k]; i++)
@@ -500,28 +603,28 @@ void make_goal_array(Puzzle *puz)
 }
 
 
-/* PICK_A_CELL - Pick a cell using the defined cell_score functions.  It prefers
- * the cells with the lowest value for cell_score_1.  If there is a tie, and
- * cell_score_2 is defined, it uses that to break ties.
+/* SCAN_FOR_CELL - Pick a cell using the defined cell_score functions.  It
+ * prefers the cells with the lowest value for cell_score_1.  If there is a
+ * tie, and cell_score_2 is defined, it uses that to break ties.  Any ties
+ * remaining go to the first cell in column order, unless we are randomizing.
+ * This looks at every cell in the grid, but only picks ones in the group we
+ * are searching, if the search has been split into groups.
  */
 
-Cell *pick_a_cell(Puzzle *puz, Solution *sol)
+static Cell *scan_for_cell(Puzzle *puz, Solution *sol)
 {
     line_t i, j;
     float score1, minscore1;
-    float score2=0, minscore2;
-    int first= 1;
+    float score2=0, minscore2=0;
+    int first= 1, nties= 0;
     Cell *cell, *favcell;
 
-    if (puz->type != PT_GRID)
-    	fail("pick_a_cell() only works for grid puzzles");
-
     for (j= 0; j < sol->n[1]; j++)
     {
     	for (i= 0; (cell= sol->line[1][j][i]) != NULL; i++)
 	{
-	    /* Not interested in solved cells */
-	    if (cell->n == 1) continue;
+	    /* Not interested in solved cells, or ones in other groups */
+	    if (cell->n == 1 || !in_group(cell)) continue;
 
 	    score1= (*cell_score_1)(puz,sol,i,j);
 
@@ -531,12 +634,19 @@ Cell *pick_a_cell(Puzzle *puz, Solution *sol)
 	    if (cell_score_2 != NULL)
 	    {
 		score2= (*cell_score_2)(puz,sol,i,j);
-		if (!first && score1 == minscore1 && score2 >= minscore2)
+		if (!first && score1 == minscore1 && score2 > minscore2)
 		    continue;
 	    }
-	    else if (!first && score1 == minscore1)
+
+	    if (!first && score1 == minscore1 &&
+		    (cell_score_2 == NULL || score2 == minscore2))
+	    {
+		/* A tie */
+		if (random_tie(++nties)) favcell= cell;
 		continue;
+	    }
 
+	    nties= 1;
 	    favcell= cell;
 	    first= 0;
 	    minscore1= score1;
@@ -555,6 +665,181 @@ Cell *pick_a_cell(Puzzle *puz, Solution *sol)
     return favcell;
 }
 
+
+/* CELL INDEX - So that we don't have to score every cell in the grid on
+ * every guess, we keep a tournament tree over the cells.  The leaves are the
+ * cells in the same column order that scan_for_cell() uses, and each inner
+ * node holds the winner of its two children, so the root holds the cell that
+ * scan_for_cell() would pick.  A cell's score can only change when a cell in
+ * its row or column is solved or unsolved, which always goes through
+ * solved_a_cell(), so that marks both lines dirty, and before each pick we
+ * rescore the cells of the dirty lines and replay their matches up the tree.
+ */
+
+static int nleaf= 0;		/* Number of leaves, a power of two */
+static int *winner;		/* Winning leaf of each node, -1 if none */
+static float *score1, *score2;	/* Scores of each leaf */
+static Cell **leafcell;		/* Cell at each leaf, NULL for padding */
+static int *dirtyline;		/* Lines to rescore, row i is i, col j is nr+j */
+static int ndirtyline;
+static char *isdirty;		/* Flags for lines in dirtyline */
+static int *dirtynode;		/* Nodes to replay */
+static int ndirtynode;
+static char *nodedirty;		/* Flags for nodes in dirtynode */
+
+#define LEAF(i,j) ((j)*sol->n[0] + (i))
+
+/* Play a match between the winners of two nodes */
+static int match(int a, int b)
+{
+    if (a < 0) return b;
+    if (b < 0) return a;
+    if (score1[a] != score1[b]) return (score1[a] < score1[b]) ? a : b;
+    if (cell_score_2 != NULL && score2[a] != score2[b])
+	return (score2[a] < score2[b]) ? a : b;
+    return (a < b) ? a : b;
+}
+
+static void mark_node(int n)
+{
+    if (!nodedirty[n])
+    {
+	nodedirty[n]= 1;
+	dirtynode[ndirtynode++]= n;
+    }
+}
+
+
+/* DIRTY_LINE - Note that the scores of cells in a line may have changed */
+
+static void dirty_line(int l)
+{
+    if (!isdirty[l])
+    {
+	isdirty[l]= 1;
+	dirtyline[ndirtyline++]= l;
+    }
+}
+
+
+/* INIT_CELL_INDEX - Build the tree, with every line marked dirty */
+
+static void init_cell_index(Puzzle *puz, Solution *sol)
+{
+    int n= sol->n[0] * sol->n[1];
+    int nlines= sol->n[0] + sol->n[1];
+    line_t i, j;
+
+    for (nleaf= 1; nleaf < n; nleaf*= 2)
+	;
+    winner= (int *)malloc(2 * nleaf * sizeof(int));
+    score1= (float *)malloc(nleaf * sizeof(float));
+    score2= (float *)calloc(nleaf, sizeof(float));
+    leafcell= (Cell **)calloc(nleaf, sizeof(Cell *));
+    dirtynode= (int *)malloc(2 * nleaf * sizeof(int));
+    nodedirty= (char *)calloc(2 * nleaf, sizeof(char));
+    dirtyline= (int *)malloc(nlines * sizeof(int));
+    isdirty= (char *)calloc(nlines, sizeof(char));
+
+    for (n= 0; n < 2 * nleaf; n++)
+	winner[n]= -1;
+    for (i= 0; i < sol->n[0]; i++)
+	for (j= 0; j < sol->n[1]; j++)
+	    leafcell[LEAF(i,j)]= sol->line[0][i][j];
+
+    ndirtyline= ndirtynode= 0;
+    for (n= 0; n < nlines; n++)
+	dirty_line(n);
+}
+
+
+/* UPDATE_CELL_INDEX - Rescore all cells in dirty lines and replay the
+ * matches above them.
+ */
+
+static void update_cell_index(Puzzle *puz, Solution *sol)
+{
+    int a, l, n;
+    line_t i, j;
+    Cell *cell;
+
+    /* Rescore the leaves, collecting the nodes above them */
+    for (a= 0; a < ndirtyline; a++)
+    {
+	l= dirtyline[a];
+	isdirty[l]= 0;
+	for (n= 0; ; n++)
+	{
+	    if (l < sol->n[0])
+	    {
+		i= l; j= n;
+		if (j >= sol->n[1]) break;
+	    }
+	    else
+	    {
+		i= n; j= l - sol->n[0];
+		if (i >= sol->n[0]) break;
+	    }
+	    cell= leafcell[LEAF(i,j)];
+	    if (cell->n == 1)
+		winner[nleaf + LEAF(i,j)]= -1;
+	    else
+	    {
+		winner[nleaf + LEAF(i,j)]= LEAF(i,j);
+		score1[LEAF(i,j)]= (*cell_score_1)(puz,sol,i,j);
+		if (cell_score_2 != NULL)
+		    score2[LEAF(i,j)]= (*cell_score_2)(puz,sol,i,j);
+	    }
+	    mark_node((nleaf + LEAF(i,j)) / 2);
+	}
+    }
+    ndirtyline= 0;
+
+    /* Replay matches, a level at a time, since every dirty node's parent
+     * is added to the list after it */
+    for (a= 0; a < ndirtynode; a++)
+    {
+	n= dirtynode[a];
+	nodedirty[n]= 0;
+	winner[n]= match(winner[2*n], winner[2*n+1]);
+	if (n > 1) mark_node(n / 2);
+    }
+    ndirtynode= 0;
+}
+
+
+/* PICK_A_CELL - Pick a cell to guess on, the same one scan_for_cell() would,
+ * but using the cell index if we can.
+ */
+
+Cell *pick_a_cell(Puzzle *puz, Solution *sol)
+{
+    Cell *cell;
+
+    if (puz->type != PT_GRID)
+    	fail("pick_a_cell() only works for grid puzzles");
+
+    /* Random tie breaking needs to see all the ties */
+    if (randomize) return scan_for_cell(puz, sol);
+
+    if (nleaf == 0) init_cell_index(puz, sol);
+    update_cell_index(puz, sol);
+
+    if (winner[1] < 0)
+    {
+    	if (VA) printf("Called pick-a-cell on complete puzzle\n");
+	return NULL;
+    }
+    cell= leafcell[winner[1]];
+
+    /* The index doesn't know about groups, so scan if it picks another */
+    if (!in_group(cell)) return scan_for_cell(puz, sol);
+
+    if (VG) printf("G: MAX CELL %d,%d SCORE=%f/%f\n",
+	cell->line[0], cell->line[1], score1[winner[1]], score2[winner[1]]);
+    return cell;
+}
+
 /* SOLVED_A_CELL - Update the solved/unsolved status of a cell.  A cell is
  * solved if it has only one possible color.
  *
@@ -575,6 +860,27 @@ void solved_a_cell(Puzzle *puz, Cell *cell, int way)
     /* Update our master count of number of solved cells */
     puz->nsolved+= way;
 
+    /* Scores of cells crossing this one may change */
+    if (nleaf > 0)
+    {
+	dirty_line(cell->line[0]);
+	dirty_line(puz->n[0] + cell->line[1]);
+    }
+
+    /* So may the set of cells to probe on */
+    frontier_update(puz, cell, way);
+
+    /* And the number left in the cell's group */
+    if (grplev != NULL) group_solved(cell, way);
+
+    /* Keep count of cells solved to something other than the goal */
+    if (goal_directed)
+    {
+	for(c= 0; c < puz->ncolor && !may_be(cell,c); c++)
+	    ;
+	if (c != GOALC(cell->line[D_ROW],cell->line[D_COL])) offgoal+= way;
+    }
+
     if (!bookkeeping) return;
 
     if (count_colors)
@@ -602,6 +908,22 @@ void solved_a_cell(Puzzle *puz, Cell *cell, int way)
 }
 
 
+/* CHANGED_A_CELL - Called by trans_cell() on every change to a cell when
+ * cell scores depend on more than which cells are solved.  Make sure that the
+ * cells in the lines through it get rescored.
+ */
+
+void changed_a_cell(Puzzle *puz, Cell *cell)
+{
+    lineprob_stale(puz, cell);
+    if (nleaf > 0)
+    {
+	dirty_line(cell->line[0]);
+	dirty_line(puz->n[0] + cell->line[1]);
+    }
+}
+
+
 /* SET_SCORING_RULE - set the guessing algorithm used for heuristic search (not
  * probing) as specified by an index number.  Returns 1 on success, 0 otherwise.
  *
@@ -616,6 +938,9 @@ void solved_a_cell(Puzzle *puz, Cell *cell, int way)
  *
  *  4 = Simpson's heuristic, more or less.
  *
+ *  7 = Pick the cell and color that is most likely, by counting the solutions
+ *      of its row and column.
+ *
  * This should always be called if we plan to use any heuristic functions.
  * If may_override is false, then the setting passed in will not override any
  * settings made by previous calls to this function.
@@ -630,6 +955,7 @@ int set_scoring_rule(int n, int may_override)
 
     count_colors= 0;
     score_adjust= 0;
+    lineprob= 0;
     switch (n)
     {
     case 1:
@@ -684,6 +1010,15 @@ int set_scoring_rule(int n, int may_override)
 	pick_color_fallback= &pick_color_contrast;
 	need_goal_array= 1;
 	return 1;
+
+    case 7:
+	/* Probabilities from counting line solutions */
+	cell_score_1= &cell_score_prob;
+	cell_score_2= &cell_score_neighbor;
+	line_score= NULL;
+	pick_color= &pick_color_lineprob;
+	lineprob= 1;
+	return 1;
     }
 
     return 0;
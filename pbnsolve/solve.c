@@ -15,6 +15,16 @@
 
 #include "pbnsolve.h"
 
+#include <math.h>
+#include <time.h>
+
+int maywave= 0;		/* Solve waves of lines in worker processes? */
+int mayrestart= 0;	/* Restart the search on a Luby schedule? */
+long restarts= 0;	/* Number of restarts done */
+
+static int wavemin= WAVE_MIN;	/* Smallest wave worth handing to workers */
+static double wavetime, wavelines;	/* Wall time spent on waves, lines */
+static double linetime, linelines;	/* Same for lines solved here */
 
 #ifdef LINEWATCH
 #define WL(k,i) (puz->clue[k][i].watch)
@@ -42,12 +52,183 @@ void guess_cell(Puzzle *puz, Solution *sol, Cell *cell, color_t c)
     cell->n= 1;
     fbit_setonly(cell->bit,c);
     solved_a_cell(puz,cell, 1);
+    trans_cell(puz, cell, h->bit);
 
     /* Put all crossing lines onto the job list */
     add_jobs(puz, sol, -1, cell, 0, h->bit);
 }
 
 
+/* WALLTIME - Elapsed time in seconds.  The workers' time doesn't show in our
+ * CPU clock, so waves have to be timed by the wall clock.
+ */
+
+static double walltime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* WAVE_WORKER - In a worker process, claim lines from the shared task list
+ * and solve each one against the grid we were given, without changing it.
+ * The lines all run in direction slot->bestc, so no two share a cell.  For
+ * each cell that would change, the new value goes into our slot.  If a line
+ * has no solution, we stop, leaving the task index in slot->best and the
+ * line number in slot->bestval.
+ */
+
+void wave_worker(Puzzle *puz, Solution *sol, WorkSlot *slot)
+{
+    dir_t k= slot->bestc;
+    line_t i, j;
+    bit_type *col, *new;
+    Cell **cell;
+    color_t z;
+    int a;
+
+    while ((a= claim_task()) >= 0)
+    {
+	i= worktask[a];
+	if ((col= lro_solve(puz, sol, k, i)) == NULL)
+	{
+	    slot->best= a;
+	    slot->bestval= i;
+	    stop_task(a);
+	    return;
+	}
+
+	cell= sol->line[k][i];
+	for (j= 0; j < puz->clue[k][i].linelen; j++)
+	{
+	    for (z= 0; z < fbit_size; z++)
+		if (cell[j]->bit[z] & ~col[j*fbit_size + z]) break;
+	    if (z == fbit_size) continue;
+
+	    new= slot->cellbit + slot->nset*fbit_size;
+	    for (z= 0; z < fbit_size; z++)
+		new[z]= cell[j]->bit[z] & col[j*fbit_size + z];
+	    slot->cellid[slot->nset++]= cell[j]->id;
+	}
+    }
+}
+
+
+/* WAVE_SOLVE - If enough lines in the direction of the top job are waiting
+ * on the job list, take them all off and have the workers solve them in
+ * parallel.  Lines in the same direction don't share cells, so this gives
+ * the same changes as solving them one at a time, except that changes made
+ * by one line can't help the others until the crossing lines have been
+ * solved, which happens in the next wave.  Returns 0 if there weren't
+ * enough jobs to bother, -1 if a line had no solution, and 1 otherwise.
+ *
+ * Each wave has a fixed cost in copying the grid to the workers and back,
+ * which only pays off if the lines are long and there are enough CPUs.  So
+ * we time the waves against the lines solved here, and each time the waves
+ * come out slower per line we double the number of lines a wave needs, and
+ * each time they come out faster we halve it again, down to WAVE_MIN.  The
+ * first WAVE_MIN lines are always solved here, to have something to compare
+ * with.
+ */
+
+static int wave_solve(Puzzle *puz, Solution *sol)
+{
+    static line_t *line= NULL;
+    static int *depth= NULL, *ldepth= NULL;
+    static bit_type **newbit= NULL;
+    extern dir_t cont_dir;
+    extern line_t cont_line;
+    extern bit_type *oldval;
+    dir_t k;
+    int a, n, w, id;
+    double start;
+    Cell *cell;
+    WorkSlot *slot;
+
+    if (line == NULL)
+    {
+	for (n= k= 0; k < puz->nset; k++)
+	    if (puz->n[k] > n) n= puz->n[k];
+	line= (line_t *)malloc(n * sizeof(line_t));
+	depth= (int *)malloc(n * sizeof(int));
+	ldepth= (int *)malloc(n * sizeof(int));
+	newbit= (bit_type **)malloc(puz->ncells * sizeof(bit_type *));
+    }
+
+    if (puz->njob < 1 || linelines < WAVE_MIN) return 0;
+    k= puz->job[1].dir;
+    if ((n= take_jobs(puz, k, line, depth, wavemin)) == 0) return 0;
+
+    init_workers(puz, sol);
+    start= walltime();
+    for (a= 0; a < n; a++)
+    {
+	worktask[a]= line[a];
+	ldepth[line[a]]= depth[a];
+    }
+    for (w= 0; w < nworkers; w++)
+	workslot[w].bestc= k;
+
+    if (VB) printf("*** WAVE OF %d %sS\n", n, CLUENAME(puz->type,k));
+
+    run_workers(puz, sol, WCMD_WAVE, n);
+    nlines+= n;
+
+    for (w= 0; w < nworkers; w++)
+	if (workslot[w].best >= 0 && workslot[w].best == workhead->stop)
+	{
+	    cont_dir= k;
+	    cont_line= workslot[w].bestval;
+	    return -1;
+	}
+
+    /* Set the changed cells in id order, so the job list comes out the same
+     * no matter which worker did what */
+    memset(newbit, 0, puz->ncells * sizeof(bit_type *));
+    for (w= 0; w < nworkers; w++)
+    {
+	slot= &workslot[w];
+	for (a= 0; a < slot->nset; a++)
+	    newbit[slot->cellid[a]]= slot->cellbit + a*fbit_size;
+    }
+
+    for (id= 0; id < puz->ncells; id++)
+    {
+	if (newbit[id] == NULL) continue;
+	cell= puz->idcell[id];
+
+	fbit_cpy(oldval, cell->bit);
+	add_hist(puz, cell, 0);
+	fbit_cpy(cell->bit, newbit[id]);
+
+	if (puz->ncolor <= 2)
+	    cell->n= 1;
+	else
+	    count_cell(puz,cell);
+	if (cell->n == 1)
+	    solved_a_cell(puz,cell,1);
+
+	trans_cell(puz, cell, oldval);
+	add_jobs(puz, sol, k, cell, ldepth[cell->line[k]] + 1, oldval);
+    }
+
+    wavetime+= walltime() - start;
+    wavelines+= n;
+    if (linelines > 0)
+    {
+	if (wavetime/wavelines > linetime/linelines)
+	    wavemin*= 2;
+	else if (wavemin > WAVE_MIN)
+	    wavemin/= 2;
+	if (VB) printf("*** WAVES NOW NEED %d LINES\n", wavemin);
+    }
+
+    return 1;
+}
+
+
 /* Find logical consequences from a current puzzle state using the line solver.
  * There must be at least one job on the job-list for this to get started.
  * Returns 0 if a contradiction was found, one otherwise.
@@ -60,10 +241,22 @@ int line_solve(Puzzle *puz, Solution *sol, int contradicting)
     extern line_t cont_line;
     dir_t dir;
     line_t i;
-    int depth;
+    int depth, rc;
+    double start;
+    int wave= maywave && nworkers > 0 && !isworker && !contradicting &&
+	!probing && !merging && !hintlog;
 
-    while (next_job(puz, &dir, &i, &depth))
+    while (1)
     {
+	/* On big grids, solve whole waves of lines in parallel */
+	if (wave && (rc= wave_solve(puz, sol)) != 0)
+	{
+	    if (rc < 0) return 0;
+	    continue;
+	}
+
+	if (!next_job(puz, &dir, &i, &depth)) break;
+
 	nlines++;
 	if ((VB && !VC) || WL(dir,i))
 	    printf("*** %s %d\n",CLUENAME(puz->type,dir), i);
@@ -89,11 +282,21 @@ int line_solve(Puzzle *puz, Solution *sol, int contradicting)
 		return 0;
 	    }
 	}
-	else if (apply_lro(puz, sol, dir, i, depth + 1))
+	else
 	{
-	    /* Found a contradiction */
-	    if (contradicting) {cont_dir= dir; cont_line= i;}
-	    return 0;
+	    /* Time the lines we solve here, to compare with the waves */
+	    if (wave) start= walltime();
+	    if (apply_lro(puz, sol, dir, i, depth + 1))
+	    {
+		/* Found a contradiction */
+		if (contradicting) {cont_dir= dir; cont_line= i;}
+		return 0;
+	    }
+	    if (wave)
+	    {
+		linetime+= walltime() - start;
+		linelines++;
+	    }
 	}
 
 	if (VJ)
@@ -163,6 +366,256 @@ int logic_solve(Puzzle *puz, Solution *sol, int contradicting)
 }
 
 
+/* LUBY - Return the i-th term of the Luby sequence, 1 1 2 1 1 2 4 1 1 2 ...
+ * counting from 1.  Running each restart for this many units is within a
+ * log factor of the best possible fixed cutoff, whatever that may be.
+ */
+
+long luby(long i)
+{
+    long k;
+
+    while (1)
+    {
+	for (k= 1; (1L << k) - 1 < i; k++)
+	    ;
+	if ((1L << k) - 1 == i) return 1L << (k-1);
+	i-= (1L << (k-1)) - 1;
+    }
+}
+
+
+/* STRATEGY CONTROL - When logic solving stalls and we have more than one way
+ * to go on, probing, heuristic guessing and contradiction search, we divide
+ * our time between them according to how fast each has been making progress.
+ * The search is run in epochs, each using one strategy for at least
+ * STRAT_EPOCH_LINES lines.  Progress is measured as the fraction of the
+ * search tree below the point where the epoch started that has been ruled
+ * out:  a contradiction found with d more guesses in force than at the start
+ * of the epoch rules out 1/2^d of it.  Each strategy keeps a decaying average
+ * of its progress per line solved, and each epoch goes to whichever
+ * has been doing best, except that every so often an epoch goes to the one
+ * that was used least recently, so we try each of them and notice when
+ * things change.  The gap between those grows while they keep losing.
+ *
+ * Nearly all the work of every strategy is line solving, so we count the
+ * cost in lines rather than CPU time.  That way the same puzzle is always
+ * solved the same way.
+ *
+ * Contradiction search doesn't choose a guess, so when it finds nothing we
+ * guess heuristically if we may, and otherwise probe.
+ */
+
+#define STRAT_PROBE 0
+#define STRAT_GUESS 1
+#define STRAT_CONTRA 2
+#define N_STRAT 3
+
+static char *stratname[N_STRAT]= {"probe", "guess", "contradict"};
+static int stratok[N_STRAT];		/* Strategies we may use */
+static int nstratok= -1;		/* How many, -1 if not yet known */
+static int strat= -1;			/* Strategy of current epoch */
+static double stratrate[N_STRAT];	/* Average progress per line */
+static double stallrate[N_STRAT];	/* Average stalls per line */
+static long stratepochs[N_STRAT];	/* Number of epochs of each */
+static long stratlines[N_STRAT];	/* Lines solved by each */
+static long stratlast[N_STRAT];		/* Epoch each was last used in */
+static long nepoch= 0;
+static long epochstart;			/* nlines when the epoch started */
+static long epochlines;			/* nlines when we started measuring */
+static int epochbase;			/* puz->nbranch at start of epoch */
+static int epochstalls;			/* Stalls in the current epoch */
+static double epochgain;		/* Progress in the current epoch */
+static long explorenext= STRAT_EXPLORE;	/* Epoch to next try something out */
+static long exploregap= STRAT_EXPLORE;	/* Epochs between trying things */
+static int exploring= 0;		/* Trying something out this epoch? */
+
+/* Which strategy picks the guesses when we are using strategy s? */
+static int strat_guesser(int s)
+{
+    if (s == STRAT_CONTRA)
+	return stratok[STRAT_GUESS] ? STRAT_GUESS : STRAT_PROBE;
+    return s;
+}
+
+static void strat_begin(Puzzle *puz, Solution *sol, int s)
+{
+    if (strat >= 0 && strat_guesser(s) != strat_guesser(strat))
+    {
+	/* Start the bookkeeping the new guesser needs */
+	if (strat_guesser(s) == STRAT_PROBE)
+	    probe_init(puz,sol);
+	else
+	    bookkeeping_on(puz,sol);
+    }
+    strat= s;
+    stratepochs[s]++;
+    stratlast[s]= ++nepoch;
+    epochstart= nlines;
+    epochbase= puz->nbranch;
+    epochstalls= 0;
+    epochgain= 0.0;
+}
+
+/* STRAT_PICK - Called each time logic solving stalls during the search.
+ * Return the strategy to use, starting a new epoch if the current one is
+ * over.
+ */
+
+static int strat_pick(Puzzle *puz, Solution *sol)
+{
+    double lines, rate, stalls;
+    int s, next, best;
+
+    if (nstratok < 0)
+    {
+	stratok[STRAT_PROBE]= mayprobe;
+	stratok[STRAT_GUESS]= mayguess || !mayprobe;
+	stratok[STRAT_CONTRA]= maycontradict;
+	for (s= nstratok= 0; s < N_STRAT; s++)
+	{
+	    stratrate[s]= -1.0;
+	    if (stratok[s]) nstratok++;
+	}
+    }
+
+    if (strat < 0)
+    {
+	/* First stall - start the way we always did, by probing */
+	strat_begin(puz, sol, stratok[STRAT_PROBE] ? STRAT_PROBE : STRAT_GUESS);
+	return strat;
+    }
+
+    if (nstratok < 2) return strat;
+
+    /* The first stall after switching may have some startup costs, like
+     * rescoring every cell, so we start measuring after it. */
+    if (++epochstalls == 1)
+    {
+	epochlines= nlines;
+	epochbase= puz->nbranch;
+	epochgain= 0.0;
+	return strat;
+    }
+
+    if (nlines - epochlines < STRAT_EPOCH_LINES)
+	return strat;
+
+    /* End of epoch - update the rates for the strategy we were using */
+    stratlines[strat]+= nlines - epochstart;
+    lines= nlines - epochlines;
+    rate= epochgain / lines;
+    stalls= (epochstalls - 1) / lines;
+    if (stratrate[strat] < 0)
+    {
+	stratrate[strat]= rate;
+	stallrate[strat]= stalls;
+    }
+    else
+    {
+	stratrate[strat]= STRAT_DECAY*stratrate[strat] + (1-STRAT_DECAY)*rate;
+	stallrate[strat]= STRAT_DECAY*stallrate[strat] + (1-STRAT_DECAY)*stalls;
+    }
+
+    /* Normally we go with whatever is doing best.  If nothing is finding
+     * any contradictions, as when there is only one solution to head for,
+     * the one that gets through stalls fastest is best. */
+    best= -1;
+    for (s= 0; s < N_STRAT; s++)
+	if (stratok[s] && (best < 0 || stratrate[s] > stratrate[best] ||
+	    (stratrate[s] == stratrate[best] &&
+	     stallrate[s] > stallrate[best])))
+	    best= s;
+
+    /* If we were trying something out, and it didn't turn out to be the
+     * best, wait longer before trying anything out again */
+    if (exploring)
+    {
+	if (best == strat)
+	    exploregap= STRAT_EXPLORE;
+	else if (exploregap < STRAT_EXPLORE_MAX)
+	    exploregap*= 2;
+	exploring= 0;
+	explorenext= nepoch + exploregap;
+    }
+
+    /* Now and then try whatever was used least recently, including things
+     * never tried at all. */
+    next= best;
+    if (nepoch >= explorenext)
+    {
+	for (s= 0; s < N_STRAT; s++)
+	    if (stratok[s] && stratlast[s] < stratlast[next])
+		next= s;
+	exploring= (next != best);
+	if (!exploring) explorenext= nepoch + exploregap;
+    }
+
+    if (VA) printf("A: STRATEGY %s (%g/line, %g stalls/line) -> %s\n",
+	    stratname[strat], rate, stalls, stratname[next]);
+
+    strat_begin(puz, sol, next);
+    return strat;
+}
+
+/* STRAT_GAIN - Credit the current epoch with n contradictions found with
+ * depth guesses in force.
+ */
+
+static void strat_gain(int depth, long n)
+{
+    if (strat < 0) return;
+
+    /* If we have backed up past where the epoch started, then everything
+     * below that is ruled out, and we measure from here on */
+    if (depth <= epochbase)
+    {
+	epochgain+= n;
+	epochbase= depth;
+    }
+    else
+	epochgain+= n * ldexp(1.0, epochbase - depth);
+}
+
+/* STRAT_RESTART - The search has been restarted from the top, so what
+ * progress the current epoch made no longer counts.  Start measuring it
+ * over again from here.
+ */
+
+static void strat_restart(Puzzle *puz)
+{
+    if (strat < 0) return;
+    stratlines[strat]+= nlines - epochstart;
+    epochstart= nlines;
+    epochbase= puz->nbranch;
+    epochgain= 0.0;
+}
+
+/* STRATEGY_STATS - Print the number of epochs and lines solved given to
+ * each strategy.
+ */
+
+void strategy_stats(FILE *fp)
+{
+    int s, comma= 0;
+    long n;
+
+    if (nstratok < 2) return;
+
+    fputs("Strategy epochs:", fp);
+    for (s= 0; s < N_STRAT; s++)
+    {
+	if (!stratok[s]) continue;
+	n= stratlines[s];
+	if (s == strat) n+= nlines - epochstart;
+	fprintf(fp,"%s %ld %s (%ld lines)", comma ? "," : "",
+	    stratepochs[s], stratname[s], n);
+	comma= 1;
+    }
+    putc('\n', fp);
+}
+
+
 /* Solve a puzzle.  Return 0 if a contradiction was found, 1 otherwise */
 
 int solve(Puzzle *puz, Solution *sol)
@@ -171,8 +624,9 @@ int solve(Puzzle *puz, Solution *sol)
     line_t besti, bestj;
     color_t bestc;
     int bestnleft;
-    int rc;
-    int sprint_clock= 0, plod_clock= PLOD_INIT;
+    int rc, probed, s;
+    int searching= 0;
+    long fails= 0, found;
 
     /* One color puzzles are already solved */
     if (puz->ncolor < 2)
@@ -182,18 +636,36 @@ int solve(Puzzle *puz, Solution *sol)
     }
 
     /* Start bookkeeping, if we need it */
-    if (mayprobe)
+    if (mayprobe && (strat < 0 || strat_guesser(strat) == STRAT_PROBE))
 	probe_init(puz,sol);
     else
 	bookkeeping_on(puz,sol);
 
     while (1)
     {
+	/* In a parallel search, share work and check if we should stop */
+	if (splitting && split_poll(puz, sol)) return 0;
+	if (remoting) remote_poll(puz, sol);
+
 	/* Always start with logical solving */
 	if (VA) printf("A: LINE SOLVING\n");
 	rc= logic_solve(puz, sol, 0);
 
-	if (rc > 0) return 1;   /* Exit if the puzzle is complete */
+	if (rc > 0)
+	{
+	    /* Exit if the puzzle is complete */
+	    group_filled();
+	    return 1;
+	}
+
+	/* If we've been in exactly this state before, and it went nowhere,
+	 * treat it as a contradiction instead of working it all out again.
+	 */
+	if (rc == 0 && trans_seen(puz))
+	{
+	    if (VA) printf("A: KNOWN DEAD END\n");
+	    rc= -1;
+	}
 
 	if (rc == 0)
 	{
@@ -205,15 +677,35 @@ int solve(Puzzle *puz, Solution *sol)
 		print_solution(stdout,puz,sol);
 	    }
 
-	    if (maycontradict)
+	    /* The first time we stall, pick the algorithms if asked to */
+	    if (mayauto)
+		auto_select(puz, sol);
+	    else if (measurefeatures)
+		auto_features(puz, sol);
+
+	    /* Once we are searching, pick a strategy for this stall */
+	    s= (searching && maybacktrack) ? strat_pick(puz,sol) : STRAT_CONTRA;
+
+	    if (maycontradict && s == STRAT_CONTRA)
 	    {
 		/* Try a depth-limited search for logical contradictions */
 		if (VA) printf("A: SEARCHING FOR CONTRADICTIONS\n");
+		found= contrafound;
 		rc= contradict(puz,sol);
 
-		if (rc > 0) return 1; /* puzzle complete - stop */
+		if (rc > 0)
+		{
+		    /* puzzle complete - stop */
+		    group_filled();
+		    return 1;
+		}
 
-		if (rc < 0) continue; /* found some - resume logic solving */
+		if (rc < 0)
+		{
+		    /* found some - resume logic solving */
+		    strat_gain(puz->nbranch + 1, contrafound - found);
+		    continue;
+		}
 
 		/* otherwise, try something else */
 	    }
@@ -221,6 +713,25 @@ int solve(Puzzle *puz, Solution *sol)
 	    /* Stop if no guessing is allowed */
 	    if (!maybacktrack) return 1;
 
+	    /* Hand the search over to clause learning if it is time to */
+	    if (cdcl_wanted(puz))
+	    {
+		if (puz->nhist > 0) restart(puz, sol);
+		rc= cdcl_solve(puz, sol);
+		if (rc) group_filled();
+		return rc;
+	    }
+
+	    if (!searching)
+	    {
+		searching= 1;
+		s= strat_pick(puz,sol);
+	    }
+
+	    /* See if the search can be split into groups, and if it is, find
+	     * the group to guess in */
+	    if (maydecompose) group_pick(puz, sol);
+
 	    if (hintlog)
 	    {
 		printf("STARTING SEARCH: EXPLANATION SHUTTING DOWN...\n");
@@ -237,77 +748,60 @@ int solve(Puzzle *puz, Solution *sol)
 		init_cache(puz);
 	    }
 
-	    if (mayprobe && (!mayguess || sprint_clock <= 0))
+	    if (strat_guesser(s) == STRAT_PROBE)
 	    {
 		/* Do probing to find best guess to make */
 		if (VA) printf("A: PROBING\n");
 	    	rc= probe(puz, sol, &besti, &bestj, &bestc);
 
 		if (rc > 0)
-		    return 1; /* Stop if accidentally completed the puzzle */
+		{
+		    /* Stop if accidentally completed the puzzle */
+		    group_filled();
+		    return 1;
+		}
 		if (rc < 0)
-		    continue; /* Resume logic solving if found contradiction */
+		{
+		    /* Resume logic solving if found contradiction */
+		    strat_gain(puz->nbranch + 1, 1);
+		    continue;
+		}
 
 		/* Otherwise, use the guess returned from the probe */
 		cell= sol->line[0][besti][bestj];
+		probed= 1;
 		if (VA)
 		{
 		    printf("A: PROBING SELECTED ");
 		    print_coord(stdout,puz,cell);
 		    printf(" COLOR %d\n",bestc);
 		}
-		
-		/* If a lot of probes have not been finding contradictions,
-		 * consider triggering sprint mode
-		 */
-		if (mayguess && --plod_clock <= 0)
-		{
-		    float rate= probe_rate();
-		    if (rate >= .12)
-		    {
-			/* More than 10% have failed to find contradiction,
-			 * so try heuristic searching for a while */
-			bookkeeping_on(puz,sol);
-			sprint_clock= SPRINT_LENGTH;
-			nsprint++;
-			/*printf("STARTING SPRINT - probe rate=%.4f\n",rate);*/
-		    }
-		    else
-		    {
-			/* Success rate of probing is still high. Keep on
-			 * trucking. */
-			plod_clock= PLOD_LENGTH;
-			nplod++;
-			/*printf("CONTINUING PLOD - probe rate=%.4f\n", rate);*/
-		    }
-		}
 	    }
 	    else
 	    {
 		/* Old guessing algorithm.  Use heuristics to make a guess */
+		probed= 0;
 		cell= pick_a_cell(puz, sol);
 		if (cell == NULL)
 		    return 0;
 
-		bestc= (*pick_color)(puz,sol,cell);
+		bestc= pick_guess_color(puz,sol,cell);
 		if (VA || WC(cell->line[0],cell->line[1]))
 		{
 		    printf("A: GUESSING SELECTED ");
 		    print_coord(stdout,puz,cell);
 		    printf(" COLOR %d\n",bestc);
 		}
-
-		if (mayprobe && --sprint_clock <= 0)
-		{
-		    /* If we have reached the end of our sprint, try plodding
-		     * again.  */
-		    probe_init(puz,sol);
-		    plod_clock= PLOD_LENGTH;
-		    nplod++;
-		    /*printf("ENDING SPRINT\n");*/
-		}
 	    }
-	    guess_cell(puz, sol, cell, bestc);
+	    if (probed)
+		/* We already know where that guess leads, so go right there */
+		probe_guess(puz, sol, cell, bestc);
+	    else
+	    {
+		guess_cell(puz, sol, cell, bestc);
+		if (!imply_check(puz, sol, cell, bestc))
+		    imply_apply(puz, sol, cell, bestc);
+	    }
 	    guesses++;
 	}
 	else
@@ -316,6 +810,11 @@ int solve(Puzzle *puz, Solution *sol)
 	    if (VA) printf("A: STUCK ON CONTRADICTION - BACKTRACKING\n");
 
 	    guesses++;
+	    strat_gain(puz->nbranch, 1);
+
+	    /* If we have run out of ways to fill in a group, skip back to
+	     * before it was split off */
+	    if (maydecompose) group_backjump(puz, sol);
 
 	    /* Back up to last guess point, and invert that guess */
 	    if (backtrack(puz,sol))
@@ -323,6 +822,22 @@ int solve(Puzzle *puz, Solution *sol)
 		return 0;
 	    if (VB) print_solution(stdout,puz,sol);
 	    if (VB) dump_history(stdout, puz, VV);
+
+	    /* If this attempt has used up its share of backtracks, throw
+	     * away all our guesses and start again, with different choices.
+	     * Only while looking for a first solution, and not when the
+	     * search is shared with others, since they depend on our guesses.
+	     */
+	    if (mayrestart && puz->found == NULL && enumlimit < 0 &&
+		!splitting && !remoting &&
+		++fails >= luby(restarts + 1) * RESTART_UNIT)
+	    {
+		if (VA) printf("A: RESTARTING SEARCH\n");
+		restart(puz, sol);
+		restarts++;
+		fails= 0;
+		strat_restart(puz);
+	    }
 	}
     }
 }
@@ -0,0 +1,363 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Parallel Search
+ *
+ * With the -aS flag, once line solving stalls the search is divided among
+ * the worker processes.  Each worker runs the normal depth-first search on
+ * its own copy of the grid.  A shared pool holds grid states that still
+ * need to be searched.  Initially it holds just the stalled grid.  When a
+ * worker runs out of work it waits for something to appear in the pool.
+ * Busy workers check, each time around the search loop, whether anyone is
+ * waiting, and if so they split off the untried alternative of their oldest
+ * guess and put it in the pool.  The oldest guess is the one whose other
+ * half is likely to be the most work.
+ *
+ * The search ends when enough solutions have been found, or when every
+ * worker is idle and the pool is empty.
+ */
+
+#include "pbnsolve.h"
+
+#include <unistd.h>
+#include <sched.h>
+
+int maysplit= 0;	/* Split the search among worker processes? */
+int splitting= 0;	/* True in a worker doing a split search */
+
+long splits= 0;		/* Number of branches given away */
+
+typedef struct {
+    volatile int lock;		/* Spin lock for all of the following */
+    volatile int npool;		/* Number of grids in the pool */
+    volatile int nidle;		/* Number of workers waiting for work */
+    volatile int nfound;	/* Number of solutions found */
+    int maxfound;		/* Stop after finding this many solutions */
+    volatile int nsplit;	/* Number of branches given away */
+    volatile int forced;	/* Solution was found without a standing guess */
+    volatile int done;		/* Set when the search is over */
+} SplitHead;
+
+static SplitHead *head= NULL;	/* Shared search state */
+static bit_type *pool;		/* Shared pool of grids to search */
+static bit_type *found;		/* Shared copies of solutions found */
+static bit_type *task= NULL;	/* In a worker, the grid we are searching */
+static int spool;		/* Capacity of the pool */
+static int inroot;		/* In a worker, are we searching the first grid? */
+
+#define GRIDSIZE(puz) ((puz)->ncells * fbit_size)
+#define POOL(puz,i) (pool + (i)*GRIDSIZE(puz))
+#define FOUND(puz,i) (found + (i)*GRIDSIZE(puz))
+
+
+static void lock(void)
+{
+    while (__sync_lock_test_and_set(&head->lock, 1))
+	sched_yield();
+}
+
+static void unlock(void)
+{
+    __sync_lock_release(&head->lock);
+}
+
+
+/* GET_TASK - In a worker, take a grid out of the pool and load it, waiting
+ * until one is available.  Returns 0 if the search is over.
+ */
+
+static int get_task(Puzzle *puz, Solution *sol)
+{
+    dir_t k;
+    line_t i;
+
+    while (!head->done)
+    {
+	lock();
+	if (head->npool > 0)
+	{
+	    head->npool--;
+	    head->nidle--;
+	    inroot= (head->npool == 0 && head->nsplit == 0);
+	    memcpy(task, POOL(puz, head->npool),
+		GRIDSIZE(puz) * sizeof(bit_type));
+	    unlock();
+
+	    load_grid(puz, sol, task);
+	    for (k= 0; k < puz->nset; k++)
+		for (i= 0; i < puz->n[k]; i++)
+		    add_job(puz, k, i, 0, 0);
+	    return 1;
+	}
+	if (head->nidle == nworkers)
+	    /* Nobody is working, so nobody will be adding more work */
+	    head->done= 1;
+	unlock();
+	usleep(SPLIT_WAIT);
+    }
+    return 0;
+}
+
+
+/* FOUND_SOLUTION - In a worker, save the solution in our grid.  If it is
+ * the first solution, and we got there from the first grid with every guess
+ * refuted, and never gave away any part of the search, then it is the only
+ * solution.
+ */
+
+static void found_solution(Puzzle *puz)
+{
+    int id;
+
+    lock();
+    if (inroot && puz->nhist == 0 && head->nsplit == 0 && head->nfound == 0)
+	head->forced= head->done= 1;
+    if (head->nfound < 2)
+	for (id= 0; id < puz->ncells; id++)
+	    fbit_cpy((FOUND(puz, head->nfound) + id*fbit_size),
+		puz->idcell[id]->bit);
+    if (++head->nfound >= head->maxfound)
+	head->done= 1;
+    unlock();
+}
+
+
+/* SPLIT_POLL - Called by solve() in a worker each time around the search
+ * loop.  If some other worker is waiting for work, give it some.  Returns
+ * true if the search is over and we should stop.
+ */
+
+int split_poll(Puzzle *puz, Solution *sol)
+{
+    if (head->done) return 1;
+
+    if (head->nidle > head->npool && puz->nbranch > 0)
+    {
+	lock();
+	if (head->nidle > head->npool && head->npool < spool &&
+		split_branch(puz, sol, POOL(puz, head->npool)))
+	{
+	    head->npool++;
+	    head->nsplit++;
+	    splits++;
+	}
+	unlock();
+    }
+    return 0;
+}
+
+
+/* SPLIT_WORKER - In a worker, search grids from the pool until the search is
+ * over.
+ */
+
+void split_worker(Puzzle *puz, Solution *sol, WorkSlot *slot)
+{
+    long old[5];
+
+    old[0]= nlines; old[1]= probes; old[2]= guesses; old[3]= backtracks;
+    old[4]= splits;
+
+    if (task == NULL)
+	task= (bit_type *)malloc(GRIDSIZE(puz) * sizeof(bit_type));
+
+    splitting= 1;
+    while (get_task(puz, sol))
+    {
+	/* Search this grid, backtracking after each solution to find more */
+	while (solve(puz, sol) && !head->done)
+	{
+	    if (puz->nsolved == puz->ncells)
+		found_solution(puz);
+	    if (head->done || backtrack(puz, sol))
+		break;
+	}
+
+	lock();
+	head->nidle++;
+	unlock();
+    }
+    splitting= 0;
+
+    slot->count[0]= nlines - old[0];
+    slot->count[1]= probes - old[1];
+    slot->count[2]= guesses - old[2];
+    slot->count[3]= backtracks - old[3];
+    slot->count[4]= splits - old[4];
+}
+
+
+/* INIT_SPLIT - Allocate the shared memory used by parallel searches.  This
+ * is called by init_workers() before it starts the workers.
+ */
+
+void init_split(Puzzle *puz)
+{
+    spool= 4 * nworkers;
+    head= (SplitHead *)share_alloc(sizeof(SplitHead) +
+	    (spool + 2) * GRIDSIZE(puz) * sizeof(bit_type));
+    pool= (bit_type *)(head + 1);
+    found= POOL(puz, spool);
+}
+
+
+/* RUN_SPLIT - Have the workers search the grids in the pool, until they find
+ * <maxfound> solutions or run out of things to search.
+ */
+
+static void run_split(Puzzle *puz, Solution *sol, int maxfound)
+{
+    int w;
+
+    head->lock= 0;
+    head->nidle= nworkers;
+    head->nfound= 0;
+    head->maxfound= maxfound;
+    head->nsplit= 0;
+    head->forced= 0;
+    head->done= 0;
+
+    run_workers(puz, sol, WCMD_SEARCH, 0);
+
+    for (w= 0; w < nworkers; w++)
+    {
+	nlines+= workslot[w].count[0];
+	probes+= workslot[w].count[1];
+	guesses+= workslot[w].count[2];
+	backtracks+= workslot[w].count[3];
+	splits+= workslot[w].count[4];
+    }
+}
+
+
+/* LOAD_FOUND - In the parent, set our grid to the i-th solution found, and
+ * return a string version of it.
+ */
+
+static char *load_found(Puzzle *puz, Solution *sol, int i)
+{
+    load_grid(puz, sol, FOUND(puz, i));
+    return solution_string(puz, sol);
+}
+
+
+/* SPLIT_SOLVE - Solve the puzzle, splitting the search among the worker
+ * processes if we need to search.  This is called instead of solve(), and
+ * leaves things the way the main program's loop of solve() calls would:
+ * the grid holds a solution if any was found, and puz->found holds the
+ * solution we would have found first when checking for uniqueness.  If
+ * <goal> is given, we prefer to report a solution that differs from it.
+ * <guessed> is set true if we had to search.  Returns the same as solve().
+ */
+
+int split_solve(Puzzle *puz, Solution *sol, char *goal, int *guessed)
+{
+    char *s;
+    int i, rc;
+
+    *guessed= 0;
+    if (nworkers == 0 || !maybacktrack || puz->ncolor < 2)
+    {
+	rc= solve(puz, sol);
+	*guessed= (puz->nhist > 0);
+	return rc;
+    }
+
+    /* Get as far as we can without searching */
+    rc= logic_solve(puz, sol, 0);
+    if (rc != 0) return rc > 0;
+
+    init_workers(puz, sol);
+
+    head->npool= 1;
+    for (i= 0; i < puz->ncells; i++)
+	fbit_cpy((POOL(puz, 0) + i*fbit_size), puz->idcell[i]->bit);
+
+    run_split(puz, sol, checkunique ? 2 : 1);
+
+    if (head->nfound == 0)
+    {
+	*guessed= 1;
+	return 0;
+    }
+
+    if (head->forced)
+    {
+	free(load_found(puz, sol, 0));
+	return 1;
+    }
+    *guessed= 1;
+
+    /* A solution that isn't the goal settles things */
+    if (goal != NULL)
+	for (i= 0; i < head->nfound && i < 2; i++)
+	{
+	    s= load_found(puz, sol, i);
+	    if (strcmp(s, goal))
+	    {
+		puz->found= s;
+		return 1;
+	    }
+	    free(s);
+	}
+
+    if (head->nfound == 1)
+    {
+	s= load_found(puz, sol, 0);
+	if (!checkunique)
+	{
+	    free(s);
+	    return 1;
+	}
+	/* Unique - report it the way a failed search for a second one does */
+	puz->found= s;
+	return 0;
+    }
+
+    puz->found= load_found(puz, sol, 1);
+    free(load_found(puz, sol, 0));
+    return 1;
+}
+
+
+/* SPLIT_REST - Having found a solution while checking uniqueness, search the
+ * rest of the search tree for another in parallel.  The untried alternatives
+ * of all our branch points go into the pool, oldest first, a poolful at a
+ * time, and the workers split them further among themselves.  Returns 1,
+ * with the grid set to the new solution, if one was found.  Otherwise
+ * returns 0.
+ */
+
+int split_rest(Puzzle *puz, Solution *sol)
+{
+    init_workers(puz, sol);
+
+    while (puz->nbranch > 0)
+    {
+	head->npool= 0;
+	while (head->npool < spool &&
+		split_branch(puz, sol, POOL(puz, head->npool)))
+	    head->npool++;
+
+	run_split(puz, sol, 1);
+
+	if (head->nfound > 0)
+	{
+	    load_grid(puz, sol, FOUND(puz, 0));
+	    return 1;
+	}
+    }
+    return 0;
+}
@@ -42,7 +42,7 @@ long nlines, probes, guesses, backtracks, merges;
 int cachelines= 0;
 int hintlog= 0, hintlogn= -1;
 int probing= 0;
-bit_type *probepad= NULL;
+Pad *probepad= NULL;
 int maylinesolve= 1;
 int count_colors= 0;
 
@@ -140,4 +140,7 @@ void fail(const char *fmt, ...)
 
 void solved_a_cell(Puzzle *puz, Cell *cell, int way) {}
 
+int lineprob= 0;
+void changed_a_cell(Puzzle *puz, Cell *cell) {}
+
 void hintsnapshot(Puzzle *puz, Solution *sol) {}
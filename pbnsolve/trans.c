@@ -0,0 +1,255 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Transposition Table
+ *
+ * Different sequences of guesses often lead to exactly the same partially
+ * solved grid.  To recognize this, we maintain a 64-bit Zobrist hash of the
+ * whole grid:  a random key is assigned to each (cell,color) pair, and the
+ * hash is the exclusive-or of the keys of all colors still possible in all
+ * cells.  Whenever a cell changes, whether by solving or by undoing, we
+ * xor out the keys of the colors that went away and xor in the keys of the
+ * colors that came back, so the hash is always up to date.
+ *
+ * We guess only when the solver has stalled.  If we have guessed a color for
+ * a cell, shown that leads to a contradiction, inverted the guess, and then
+ * shown that leads to a contradiction too, then the stalled grid state we
+ * were in when we made the guess has no solution.  We save its hash in a
+ * fixed-size table.  If the solver ever stalls in the same state again,
+ * whether in the search or in a probe, we can treat it as a contradiction
+ * at once.
+ *
+ * Once we have found one solution and are checking for others, backtracks
+ * no longer mean there was no solution, so we stop saving states then.
+ *
+ * The same keys are used to keep a hash of each row and column, which lets
+ * contradict() and probe() tell if the lines a test depended on have changed
+ * since it was done.  Column hashes use the keys with their halves swapped,
+ * so that a cell in both a row and a column being combined doesn't cancel
+ * out.
+ */
+
+#include "pbnsolve.h"
+
+int maytrans= 0;		/* Is the transposition table enabled? */
+long trans_add, trans_hit;
+
+static zkey_t *zkey= NULL;	/* Random key for each (cell,color) */
+static zkey_t gridhash;		/* Hash of current grid */
+static zkey_t *transtab= NULL;	/* Hashes of grids known to have no solution */
+
+static zkey_t *linehash[2];	/* Hash of each row and column */
+
+#define ZKEY(puz,cell,c) zkey[(cell)->id * (puz)->ncolor + (c)]
+#define COLKEY(z) (((z) << 32) | ((z) >> 32))
+#define TRANSINDEX(h) ((h) % TRANS_SIZE)
+
+
+/* ZRAND - Generate a 64-bit pseudo-random number.  This is the splitmix64
+ * generator.  We always start with the same seed so that runs are repeatable.
+ */
+
+static zkey_t zrand(void)
+{
+    static zkey_t state= 0x9E3779B97F4A7C15ULL;
+    zkey_t z;
+
+    z= (state+= 0x9E3779B97F4A7C15ULL);
+    z= (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z= (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+/* MAKE_KEYS - Allocate the keys, if we haven't already, and compute the hash
+ * of the current grid.  After this is called, every change to any cell must
+ * be reported to trans_cell().
+ */
+
+static void make_keys(Puzzle *puz, Solution *sol)
+{
+    int i, n= puz->ncells * puz->ncolor;
+    line_t j, k;
+    color_t c;
+    Cell *cell;
+
+    if (zkey != NULL) return;
+
+    zkey= (zkey_t *)malloc(n * sizeof(zkey_t));
+    for (i= 0; i < n; i++)
+	zkey[i]= zrand();
+
+    gridhash= 0;
+    for (j= 0; j < sol->n[D_ROW]; j++)
+	for (k= 0; (cell= sol->line[D_ROW][j][k]) != NULL; k++)
+	    for (c= 0; c < puz->ncolor; c++)
+		if (bit_test(cell->bit, c))
+		    gridhash^= ZKEY(puz,cell,c);
+}
+
+
+/* INIT_TRANS - Allocate the keys and the transposition table, and compute
+ * the hash of the current grid.
+ */
+
+void init_trans(Puzzle *puz, Solution *sol)
+{
+    make_keys(puz, sol);
+    transtab= (zkey_t *)calloc(TRANS_SIZE, sizeof(zkey_t));
+}
+
+
+/* INIT_LINEHASH - Start keeping hashes of each row and column.  Only for
+ * grid puzzles.
+ */
+
+void init_linehash(Puzzle *puz, Solution *sol)
+{
+    line_t j, k;
+    color_t c;
+    Cell *cell;
+
+    if (linehash[0] != NULL) return;
+    make_keys(puz, sol);
+
+    for (k= 0; k < 2; k++)
+	linehash[k]= (zkey_t *)calloc(sol->n[k], sizeof(zkey_t));
+    for (j= 0; j < sol->n[D_ROW]; j++)
+	for (k= 0; (cell= sol->line[D_ROW][j][k]) != NULL; k++)
+	    for (c= 0; c < puz->ncolor; c++)
+		if (bit_test(cell->bit, c))
+		{
+		    linehash[D_ROW][j]^= ZKEY(puz,cell,c);
+		    linehash[D_COL][k]^= COLKEY(ZKEY(puz,cell,c));
+		}
+}
+
+
+/* TRANS_CELL - The given cell has just been changed.  Its old bit string
+ * was <old>.  Update the grid hash.  Since this only looks at which bits
+ * differ, it can also be called just before changing a cell back to <old>.
+ */
+
+void trans_cell(Puzzle *puz, Cell *cell, bit_type *old)
+{
+    color_t c;
+
+    /* The -aG7 heuristic needs to know about every change too */
+    if (lineprob) changed_a_cell(puz, cell);
+
+    if (zkey == NULL) return;
+
+    for (c= 0; c < puz->ncolor; c++)
+	if (!bit_test(old, c) != !bit_test(cell->bit, c))
+	{
+	    gridhash^= ZKEY(puz,cell,c);
+	    if (linehash[0] != NULL)
+	    {
+		linehash[D_ROW][cell->line[D_ROW]]^= ZKEY(puz,cell,c);
+		linehash[D_COL][cell->line[D_COL]]^= COLKEY(ZKEY(puz,cell,c));
+	    }
+	}
+}
+
+
+/* LINES_HASH - Return the combined hash of rows r0 through r1 and columns
+ * c0 through c1.
+ */
+
+static zkey_t lines_hash(line_t r0, line_t r1, line_t c0, line_t c1)
+{
+    zkey_t h= 0;
+
+    for ( ; r0 <= r1; r0++)
+	h^= linehash[D_ROW][r0];
+    for ( ; c0 <= c1; c0++)
+	h^= linehash[D_COL][c0];
+    return h;
+}
+
+
+/* REACH_MARK - We have just done some test, and everything it changed is in
+ * the history from index <h0> on.  Save the range of rows and columns that
+ * were changed.  Call reach_seal() after it has been undone.
+ */
+
+void reach_mark(Puzzle *puz, Reach *r, int h0)
+{
+    Cell *cell;
+    line_t i, j;
+
+    r->r0= r->c0= MAXLINE;
+    r->r1= r->c1= -1;
+    for ( ; h0 < puz->nhist; h0++)
+    {
+	cell= HISTCELL(puz,HIST(puz,h0));
+	i= cell->line[D_ROW];
+	j= cell->line[D_COL];
+	if (i < r->r0) r->r0= i;
+	if (i > r->r1) r->r1= i;
+	if (j < r->c0) r->c0= j;
+	if (j > r->c1) r->c1= j;
+    }
+}
+
+
+/* REACH_SEAL - Save the current hash of the lines in a reach */
+
+void reach_seal(Reach *r)
+{
+    r->hash= lines_hash(r->r0, r->r1, r->c0, r->c1);
+}
+
+
+/* REACH_SAME - Return true if none of the lines in a reach have changed since
+ * it was sealed.  A test that depends only on those lines would come out the
+ * same as it did then.
+ */
+
+int reach_same(Reach *r)
+{
+    return r->r1 >= 0 && lines_hash(r->r0, r->r1, r->c0, r->c1) == r->hash;
+}
+
+
+/* TRANS_SAVE - Undo has just backed out an inverted guess, and the cells are
+ * all back to the state they were in just before the guess was made.  Save
+ * that state as having no solution.
+ */
+
+void trans_save(Puzzle *puz)
+{
+    if (transtab == NULL || puz->found != NULL || gridhash == 0) return;
+
+    /* Just overwrite whatever was there before */
+    transtab[TRANSINDEX(gridhash)]= gridhash;
+    trans_add++;
+}
+
+
+/* TRANS_SEEN - Return true if the current grid state is known to have no
+ * solution.
+ */
+
+int trans_seen(Puzzle *puz)
+{
+    if (transtab == NULL || gridhash == 0 ||
+	    transtab[TRANSINDEX(gridhash)] != gridhash)
+	return 0;
+
+    trans_hit++;
+    return 1;
+}
+
@@ -0,0 +1,363 @@
+/* Copyright 2013 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Worker Processes
+ *
+ * Some of our searches consist of many independent trials run on the same
+ * grid, like the probes in a probe sequence.  These can be farmed out to a
+ * pool of worker processes.  We use forked processes instead of threads
+ * because the solver keeps most of its state in global variables, and this
+ * way each worker gets a private copy of all of it - its own grid, job list,
+ * history, line solver scratch space and caches - without our having to
+ * change any of that code.
+ *
+ * The workers are forked the first time they are needed, and then wait for
+ * commands on a pipe.  Before sending a command, the parent copies its grid
+ * into a shared memory area, and each worker starts by bringing its own copy
+ * of the grid up to date with that.  The parent's algorithm flags go along
+ * with the grid, since the parent changes some of them as it goes, like
+ * turning off the exhaustive check when the search starts, and the copies
+ * the workers got when they were forked would be stale.  The parent also
+ * puts a list of tasks in shared memory.  Workers claim tasks from the list
+ * with an atomic counter, so each is done exactly once, and leave their
+ * results in their own slot of the shared area.  When a worker finds
+ * something that makes further tasks pointless, like a contradiction, it
+ * lowers the stop index so no one claims tasks after it.  Tasks before it
+ * still get done, so the parent can always pick the result with the lowest
+ * task index, which makes the outcome the same no matter how the work was
+ * divided up.
+ */
+
+#include "pbnsolve.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+int nworkers= 0;		/* Number of worker processes to use */
+int isworker= 0;		/* True in the worker processes */
+
+WorkHead *workhead= NULL;	/* Shared task list header */
+int *worktask= NULL;		/* Shared task list */
+WorkSlot *workslot= NULL;	/* Result slots, one per worker */
+WorkSlot *myslot= NULL;		/* In a worker, its own result slot */
+
+static bit_type *snapbit= NULL;	/* Shared copy of the parent's grid */
+static pid_t *workpid= NULL;	/* Process ids of workers */
+static int *tofd, *fromfd;	/* Pipes to and from the workers */
+
+#define SNAPBIT(id) (snapbit + (id)*fbit_size)
+
+
+/* LOAD_GRID - In a worker, make our grid match <grid>, an array of ncells
+ * bitstrings, normally the snapshot of the parent's grid.  Lines through any
+ * cell that changed lose their saved left and right solutions.  History and
+ * jobs are discarded.  Saved implications stay valid so long as the new grid
+ * is a refinement of the old one, otherwise we discard them.
+ */
+
+void load_grid(Puzzle *puz, Solution *sol, bit_type *grid)
+{
+    static bit_type *old= NULL;
+    Cell *cell;
+    bit_type *snap;
+    int id, diff, wider= 0;
+    color_t z;
+    dir_t k;
+
+    if (old == NULL)
+	old= (bit_type *)malloc(fbit_size * sizeof(bit_type));
+
+    for (id= 0; id < puz->ncells; id++)
+    {
+	cell= puz->idcell[id];
+	snap= grid + id*fbit_size;
+
+	diff= 0;
+	for (z= 0; z < fbit_size; z++)
+	{
+	    if (cell->bit[z] != snap[z]) diff= 1;
+	    if (snap[z] & ~cell->bit[z]) wider= 1;
+	}
+	if (!diff) continue;
+
+	if (cell->n == 1) solved_a_cell(puz, cell, -1);
+	fbit_cpy(old, cell->bit);
+	fbit_cpy(cell->bit, snap);
+	count_cell(puz, cell);
+	if (cell->n == 1) solved_a_cell(puz, cell, 1);
+	trans_cell(puz, cell, old);
+
+	for (k= 0; k < puz->nset; k++)
+	{
+	    puz->clue[k][cell->line[k]].lbadb= -1;
+	    puz->clue[k][cell->line[k]].rbadb= -1;
+	}
+    }
+
+    puz->nhist= 0;
+    puz->nbranch= 0;
+    puz->ninverted= 0;
+    flush_jobs(puz);
+    imply_trim(wider ? -1 : 0);
+}
+
+
+/* LOAD_FLAGS - In a worker, adopt the algorithm flags the parent sent with
+ * the current command.  If the parent has started caching line solutions,
+ * we start too.
+ */
+
+static void load_flags(Puzzle *puz)
+{
+    maylinesolve= workhead->linesolve;
+    mayexhaust= workhead->exhaust;
+    maycontradict= workhead->contradict;
+    mayguess= workhead->guess;
+    mayprobe= workhead->probe;
+
+    if (workhead->cache && !cachelines)
+    {
+	cachelines= 1;
+	init_cache(puz);
+    }
+}
+
+
+/* WORKER_LOOP - Main loop of a worker process.  Wait for commands from the
+ * parent and do them.  Exit when the parent closes the pipe.
+ */
+
+static void worker_loop(Puzzle *puz, Solution *sol, int in, int out)
+{
+    char cmd;
+
+    /* The parent handles interrupts, and kills us when it is done.  If we
+     * run out of CPU time we just die, and the parent reports the timeout.
+     * We don't talk. */
+    signal(SIGINT, SIG_IGN);
+    signal(SIGXCPU, SIG_DFL);
+    memset(verb, 0, NVERB * sizeof(int));
+
+    while (read(in, &cmd, 1) == 1)
+    {
+	load_flags(puz);
+	load_grid(puz, sol, snapbit);
+
+	switch (cmd)
+	{
+	case WCMD_PROBE:
+	    probe_worker(puz, sol, myslot);
+	    break;
+	case WCMD_WAVE:
+	    wave_worker(puz, sol, myslot);
+	    break;
+	case WCMD_EXHAUST:
+	    exhaust_worker(puz, sol, myslot);
+	    break;
+	case WCMD_CONTRADICT:
+	    contradict_worker(puz, sol, myslot);
+	    break;
+	case WCMD_SEARCH:
+	    split_worker(puz, sol, myslot);
+	    break;
+	}
+
+	if (write(out, &cmd, 1) != 1) break;
+    }
+    _exit(0);
+}
+
+
+/* SHARE_ALLOC - Allocate <size> bytes of memory that will be shared with the
+ * worker processes.  This must be done before the workers are started.
+ */
+
+void *share_alloc(size_t size)
+{
+    void *p;
+
+    if (workpid != NULL)
+	fail("Shared memory must be allocated before starting workers\n");
+
+    p= mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+	fail("Could not allocate shared memory for workers\n");
+    return p;
+}
+
+
+/* STOP_WORKERS - Kill all the worker processes.  Called at exit. */
+
+static void stop_workers(void)
+{
+    int w;
+
+    if (isworker || workpid == NULL) return;
+
+    for (w= 0; w < nworkers; w++)
+    {
+	close(tofd[w]);
+	kill(workpid[w], SIGKILL);
+    }
+    for (w= 0; w < nworkers; w++)
+	waitpid(workpid[w], NULL, 0);
+}
+
+
+/* INIT_WORKERS - Allocate the shared memory and fork off the workers, if
+ * that hasn't been done already.  This must be called before putting tasks
+ * in worktask[].
+ */
+
+void init_workers(Puzzle *puz, Solution *sol)
+{
+    size_t size, bitsize, slotsize;
+    char *p;
+    int w, v, fd1[2], fd2[2];
+
+    if (workpid != NULL) return;
+
+    bitsize= puz->ncells * fbit_size * sizeof(bit_type);
+    slotsize= puz->ncells * sizeof(int) + bitsize;
+    size= sizeof(WorkHead) + nworkers * sizeof(WorkSlot) +
+	puz->ncells * sizeof(int) + bitsize + nworkers * slotsize;
+
+    p= (char *)share_alloc(size);
+
+    /* Lay out the shared area - widest types first, to keep them aligned */
+    workslot= (WorkSlot *)p; p+= nworkers * sizeof(WorkSlot);
+    snapbit= (bit_type *)p; p+= bitsize;
+    for (w= 0; w < nworkers; w++)
+	workslot[w].cellbit= (bit_type *)p, p+= bitsize;
+    workhead= (WorkHead *)p; p+= sizeof(WorkHead);
+    for (w= 0; w < nworkers; w++)
+	workslot[w].cellid= (int *)p, p+= puz->ncells * sizeof(int);
+    worktask= (int *)p;
+
+    /* Workers may be asked to search */
+    if (maybacktrack) init_split(puz);
+
+    workpid= (pid_t *)malloc(nworkers * sizeof(pid_t));
+    tofd= (int *)malloc(nworkers * sizeof(int));
+    fromfd= (int *)malloc(nworkers * sizeof(int));
+
+    /* Don't let the children inherit unwritten output */
+    fflush(stdout);
+    fflush(stderr);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (w= 0; w < nworkers; w++)
+    {
+	if (pipe(fd1) || pipe(fd2))
+	    fail("Could not create pipes for workers\n");
+
+	if ((workpid[w]= fork()) < 0)
+	    fail("Could not fork worker process\n");
+
+	if (workpid[w] == 0)
+	{
+	    /* Child - close all pipes except our own */
+	    for (v= 0; v < w; v++)
+	    {
+		close(tofd[v]);
+		close(fromfd[v]);
+	    }
+	    close(fd1[1]);
+	    close(fd2[0]);
+	    isworker= 1;
+	    myslot= &workslot[w];
+	    worker_loop(puz, sol, fd1[0], fd2[1]);
+	}
+
+	close(fd1[0]);
+	close(fd2[1]);
+	tofd[w]= fd1[1];
+	fromfd[w]= fd2[0];
+    }
+
+    atexit(stop_workers);
+}
+
+
+/* RUN_WORKERS - Have all workers do the command <cmd> on the current grid.
+ * <ntask> tasks should already have been placed in worktask[].  Returns
+ * when all the workers are done.  Results can then be found in workslot[].
+ */
+
+void run_workers(Puzzle *puz, Solution *sol, int cmd, int ntask)
+{
+    int id, w, status;
+    char c= cmd;
+
+    for (id= 0; id < puz->ncells; id++)
+	fbit_cpy(SNAPBIT(id), puz->idcell[id]->bit);
+
+    workhead->ntask= ntask;
+    workhead->next= 0;
+    workhead->stop= ntask;
+    workhead->linesolve= maylinesolve;
+    workhead->exhaust= mayexhaust;
+    workhead->contradict= maycontradict;
+    workhead->guess= mayguess;
+    workhead->probe= mayprobe;
+    workhead->cache= cachelines;
+    for (w= 0; w < nworkers; w++)
+    {
+	workslot[w].best= -1;
+	workslot[w].nset= 0;
+	memset(workslot[w].count, 0, sizeof(workslot[w].count));
+    }
+
+    for (w= 0; w < nworkers; w++)
+	if (write(tofd[w], &c, 1) != 1)
+	    fail("Lost contact with worker process\n");
+    for (w= 0; w < nworkers; w++)
+	if (read(fromfd[w], &c, 1) != 1)
+	{
+	    if (waitpid(workpid[w], &status, 0) == workpid[w] &&
+		    WIFSIGNALED(status) && WTERMSIG(status) == SIGXCPU)
+		timeout(SIGXCPU);
+	    fail("Lost contact with worker process\n");
+	}
+}
+
+
+/* CLAIM_TASK - In a worker, get the index of the next task to do.  Returns
+ * -1 if there are no more tasks that need doing.
+ */
+
+int claim_task(void)
+{
+    int i= __sync_fetch_and_add(&workhead->next, 1);
+
+    return (i < workhead->stop) ? i : -1;
+}
+
+
+/* STOP_TASK - In a worker, report that task <i> ended the run, so no tasks
+ * after it need to be done.  If another worker already stopped at an
+ * earlier task, that one stands.
+ */
+
+void stop_task(int i)
+{
+    int old;
+
+    while (i < (old= workhead->stop))
+	if (__sync_bool_compare_and_swap(&workhead->stop, old, i))
+	    break;
+}